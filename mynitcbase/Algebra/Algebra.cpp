@@ -95,29 +95,29 @@ int Algebra::select(char srcRel[ATTR_SIZE], char targetRel[ATTR_SIZE],
   }
 
   /*** Selecting and inserting records into the target relation ***/
-  /* Before calling the search function, reset the search to start from the
-     first using RelCacheTable::resetSearchIndex() */
 
   Attribute record[src_nAttrs];
 
   /*
       The BlockAccess::search() function can either do a linearSearch or
-      a B+ tree search. Hence, reset the search index of the relation in the
-      relation cache using RelCacheTable::resetSearchIndex().
-      Also, reset the search index in the attribute cache for the select
-      condition attribute with name given by the argument `attr`. Use
-      AttrCacheTable::resetSearchIndex().
-      Both these calls are necessary to ensure that search begins from the
-      first record.
+      a B+ tree search. The search is carried by a cursor of its own (see
+      SearchCursor) rather than the search indices of the caches, started at
+      the first record: both its scan cursor (ScanCursor::open()) and its
+      index cursor (IndexCursor::start()) are started.
   */
-  RelCacheTable::resetSearchIndex(srcRelId);
-  AttrCacheTable::resetSearchIndex(srcRelId, attr);
+  SearchCursor cursor;
+  cursor.scan.open(srcRelId);
+  cursor.index.start();
+
+  // the condition is resolved once, for the type of the attribute and the
+  // op, into the comparison every record is tested with (see Predicate)
+  Predicate predicate(type, op, attrVal);
 
   // read every record that satisfies the condition by repeatedly calling
   // BlockAccess::search() until there are no more records to be read
 
   /* while BlockAccess::search() returns success */
-  while (BlockAccess::search(srcRelId, record, attr, attrVal, op) == SUCCESS) {
+  while (BlockAccess::search(&cursor, srcRelId, record, attr, predicate) == SUCCESS) {
 
     // ret = BlockAccess::insert(targetRelId, record);
     ret = BlockAccess::insert(targetRelId, record);
@@ -371,14 +371,15 @@ int Algebra::project(char srcRel[ATTR_SIZE], char targetRel[ATTR_SIZE]) {
 
   /*** Inserting projected records into the target relation ***/
 
-  // Take care to reset the searchIndex before calling the project function
-  // using RelCacheTable::resetSearchIndex()
-  RelCacheTable::resetSearchIndex(srcRelId);
+  // the records are projected with a scan cursor of our own, started at the
+  // first record of the relation (see ScanCursor::open())
+  ScanCursor cursor;
+  cursor.open(srcRelId);
 
   Attribute record[numAttrs];
 
-  /* BlockAccess::project(srcRelId, record) returns SUCCESS */
-  while (BlockAccess::project(srcRelId, record) == SUCCESS) {
+  /* BlockAccess::project(&cursor, srcRelId, record) returns SUCCESS */
+  while (BlockAccess::project(&cursor, srcRelId, record) == SUCCESS) {
     // record will contain the next record
 
     // ret = BlockAccess::insert(targetRelId, proj_record);
@@ -476,14 +477,15 @@ int Algebra::project(char srcRel[ATTR_SIZE], char targetRel[ATTR_SIZE],
 
   /*** Inserting projected records into the target relation ***/
 
-  // Take care to reset the searchIndex before calling the project function
-  // using RelCacheTable::resetSearchIndex()
-  RelCacheTable::resetSearchIndex(srcRelId);
+  // the records are projected with a scan cursor of our own, started at the
+  // first record of the relation (see ScanCursor::open())
+  ScanCursor cursor;
+  cursor.open(srcRelId);
 
   Attribute record[src_nAttrs];
 
-  /* while BlockAccess::project(srcRelId, record) returns SUCCESS */
-  while (BlockAccess::project(srcRelId, record) == SUCCESS) {
+  /* while BlockAccess::project(&cursor, srcRelId, record) returns SUCCESS */
+  while (BlockAccess::project(&cursor, srcRelId, record) == SUCCESS) {
     // the variable `record` will contain the next record
 
     Attribute proj_record[tar_nAttrs];
@@ -661,25 +663,26 @@ int Algebra::join(char srcRelation1[ATTR_SIZE], char srcRelation2[ATTR_SIZE],
   Attribute record2[numOfAttributes2];
   Attribute targetRecord[numOfAttributesInTarget];
 
-  // resetting searchIndex before project
-  RelCacheTable::resetSearchIndex(srcRelId1);
+  // each relation is searched with a cursor of its own (so a relation may
+  // even be joined with itself); the outer one starts at the first record
+  ScanCursor outerCursor;
+  outerCursor.open(srcRelId1);
+  SearchCursor innerCursor;
 
   // this loop is to get every record of the srcRelation1 one by one
-  while (BlockAccess::project(srcRelId1, record1) == SUCCESS) {
-
-    // reset the search index of `srcRelation2` in the relation cache
-    // using RelCacheTable::resetSearchIndex()
-    RelCacheTable::resetSearchIndex(srcRelId2);
+  while (BlockAccess::project(&outerCursor, srcRelId1, record1) == SUCCESS) {
 
-    // reset the search index of `attribute2` in the attribute cache
-    // using AttrCacheTable::resetSearchIndex()
-    AttrCacheTable::resetSearchIndex(srcRelId2, attribute2);
+    // restart the search of `srcRelation2` at its first record, for both
+    // the scan of the relation and the search of the index of `attribute2`
+    innerCursor.scan.open(srcRelId2);
+    innerCursor.index.start();
 
     // this loop is to get every record of the srcRelation2 which satisfies
     // the following condition:
     // record1.attribute1 = record2.attribute2 (i.e. Equi-Join condition)
-    while (BlockAccess::search(srcRelId2, record2, attribute2,
-                               record1[attrCatEntry1.offset], EQ) == SUCCESS) {
+    Predicate predicate(attrCatEntry2.attrType, EQ, record1[attrCatEntry1.offset]);
+    while (BlockAccess::search(&innerCursor, srcRelId2, record2, attribute2, predicate) ==
+           SUCCESS) {
 
       // copy srcRelation1's and srcRelation2's attribute values(except
       // for attribute2 in rel2) from record1 and record2 to targetRecord
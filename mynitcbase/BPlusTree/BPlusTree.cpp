@@ -1,7 +1,12 @@
 #include "BPlusTree.h"
 
-// #include <cstring>
+#include <cstring>
 
+/*
+Used to search the B+ tree of an attribute from its search index in the
+attribute cache (see the search below, which is given the search index as a
+cursor); the search index is moved to the entry of the record found.
+*/
 RecId BPlusTree::bPlusSearch(int relId, char attrName[ATTR_SIZE],
                              Attribute attrVal, int op) {
   // declare searchIndex which will be used to store search index for attrName.
@@ -11,6 +16,39 @@ RecId BPlusTree::bPlusSearch(int relId, char attrName[ATTR_SIZE],
      using AttrCacheTable::getSearchIndex(). */
   AttrCacheTable::getSearchIndex(relId, attrName, &searchIndex);
 
+  // the condition is resolved for the type of the attribute (see Predicate)
+  AttrCatEntry attrCatEntry;
+  if (AttrCacheTable::getAttrCatEntry(relId, attrName, &attrCatEntry) != SUCCESS) {
+    return RecId{-1, -1};
+  }
+  Predicate predicate(attrCatEntry.attrType, op, attrVal);
+
+  IndexCursor cursor;
+  cursor.seek(searchIndex);
+  RecId recId = bPlusSearch(&cursor, relId, attrName, predicate);
+
+  if (recId.block != -1) {
+    searchIndex = cursor.getPosition();
+    AttrCacheTable::setSearchIndex(relId, attrName, &searchIndex);
+  }
+  return recId;
+}
+
+/*
+Used to search the B+ tree of an attribute for the next record satisfying the
+predicate, from the position of the cursor on (the first entry of the tree if
+the cursor was just started). The cursor is moved to the entry of the record
+found.
+*/
+RecId BPlusTree::bPlusSearch(IndexCursor *cursor, int relId, char attrName[ATTR_SIZE],
+                             const Predicate &predicate) {
+  // count the use of the buffer against the relation (see STATS)
+  RelationStatsScope statsScope(relId);
+
+  // the search index is the position of the cursor
+  IndexId searchIndex = cursor->getPosition();
+  int op = predicate.getOp();
+
   AttrCatEntry attrCatEntry;
   /* load the attribute cache entry into attrCatEntry using
    AttrCacheTable::getAttrCatEntry(). */
@@ -76,95 +114,124 @@ RecId BPlusTree::bPlusSearch(int relId, char attrName[ATTR_SIZE],
   */
 
   /*while block is of type IND_INTERNAL */
-  // use StaticBuffer::getStaticBlockType()
-
-  while (StaticBuffer::getStaticBlockType(block) == IND_INTERNAL) {
+  // (the type is taken from the header of the block, which is read anyway,
+  // rather than with StaticBuffer::getStaticBlockType(), which would lock the
+  // block allocation map on every level of the tree)
+  while (true) {
 
     // load the block into internalBlk using IndInternal::IndInternal().
     IndInternal internalBlk(block);
 
-    HeadInfo intHead;
+    int blockType;
+    int child;
 
-    // load the header of internalBlk into intHead using
-    // BlockBuffer::getHeader()
-    internalBlk.getHeader(&intHead);
+    // the header and the entries of the block are read optimistically,
+    // without pinning or latching it (see OptimisticRead), and read again if
+    // the block was changed meanwhile; they are read in place in the buffer
+    // (see BlockView)
+    for (int attempt = 0;; attempt++) {
+      OptimisticRead read(internalBlk, attempt);
+      if (read.getStatus() != SUCCESS) {
+        return RecId{-1, -1};
+      }
 
-    // declare intEntry which will be used to store an entry of internalBlk.
-    InternalEntry intEntry;
+      // get the header of internalBlk using BlockBuffer::getHeaderView()
+      const struct HeadInfo *intHead;
+      internalBlk.getHeaderView(&intHead);
+      blockType = intHead->blockType;
+      if (blockType != IND_INTERNAL) {
+        // (a leaf is reached)
+        if (read.validate()) {
+          break;
+        }
+        continue;
+      }
 
-    /*if op is one of NE, LT, LE */
-    if (op == NE || op == LT || op == LE) {
-      /*
-      - NE: need to search the entire linked list of leaf indices of the B+
-      Tree, starting from the leftmost leaf index. Thus, always move to the
-      left.
+      // declare intEntry which will be used to view an entry of internalBlk.
+      struct BlockView intEntry;
 
-      - LT and LE: the attribute values are arranged in ascending order in the
-      leaf indices of the B+ Tree. Values that satisfy these conditions, if
-      any exist, will always be found in the left-most leaf index. Thus,
-      always move to the left.
-      */
+      /*if op is one of NE, LT, LE */
+      if (op == NE || op == LT || op == LE) {
+        /*
+        - NE: need to search the entire linked list of leaf indices of the B+
+        Tree, starting from the leftmost leaf index. Thus, always move to the
+        left.
 
-      // load entry in the first slot of the block into intEntry
-      // using IndInternal::getEntry().
-      internalBlk.getEntry(&intEntry, index);
+        - LT and LE: the attribute values are arranged in ascending order in
+        the leaf indices of the B+ Tree. Values that satisfy these conditions,
+        if any exist, will always be found in the left-most leaf index. Thus,
+        always move to the left.
+        */
 
-      block = intEntry.lChild;
+        // view the entry in the first slot of the block using
+        // IndInternal::getEntryView().
+        internalBlk.getEntryView(&intEntry, index);
 
-    } else {
-      /*
-      - EQ, GT and GE: move to the left child of the first entry that is
-      greater than (or equal to) attrVal
-      (we are trying to find the first entry that satisfies the condition.
-      since the values are in ascending order we move to the left child which
-      might contain more entries that satisfy the condition)
-      */
-
-      /*
-       traverse through all entries of internalBlk and find an entry that
-       satisfies the condition.
-       if op == EQ or GE, then intEntry.attrVal >= attrVal
-       if op == GT, then intEntry.attrVal > attrVal
-       Hint: the helper function compareAttrs() can be used for comparing
-      */
-
-      int entryIndex = -1;
-
-      if (op == EQ || op == GE) {
-
-        for (int i = index; i < intHead.numEntries; i++) {
-          internalBlk.getEntry(&intEntry, i);
-          if (compareAttrs(intEntry.attrVal, attrVal, attrCatEntry.attrType) >=
-              0) {
-            entryIndex = i;
-            break;
-          }
-        }
-      } else {
+        child = viewInt(&intEntry, 0);  // lChild
 
-        for (int i = index; i < intHead.numEntries; i++) {
-          internalBlk.getEntry(&intEntry, i);
-          if (compareAttrs(intEntry.attrVal, attrVal, attrCatEntry.attrType) >
-              0) {
-            entryIndex = i;
-            break;
+      } else {
+        /*
+        - EQ, GT and GE: move to the left child of the first entry that is
+        greater than (or equal to) attrVal
+        (we are trying to find the first entry that satisfies the condition.
+        since the values are in ascending order we move to the left child which
+        might contain more entries that satisfy the condition)
+        */
+
+        /*
+         traverse through all entries of internalBlk and find an entry that
+         satisfies the condition.
+         if op == EQ or GE, then intEntry.attrVal >= attrVal
+         if op == GT, then intEntry.attrVal > attrVal
+         (the entries are compared to the value of the predicate with
+         Predicate::compare())
+        */
+
+        int entryIndex = -1;
+
+        if (op == EQ || op == GE) {
+
+          for (int i = index; i < intHead->numEntries; i++) {
+            internalBlk.getEntryView(&intEntry, i);
+            if (predicate.compare(viewAttr(&intEntry, 4)) >= 0) {
+              entryIndex = i;
+              break;
+            }
+          }
+        } else {
+
+          for (int i = index; i < intHead->numEntries; i++) {
+            internalBlk.getEntryView(&intEntry, i);
+            if (predicate.compare(viewAttr(&intEntry, 4)) > 0) {
+              entryIndex = i;
+              break;
+            }
           }
         }
+        /*if such an entry is found*/
+        if (entryIndex != -1) {
+          // move to the left child of that entry
+          internalBlk.getEntryView(&intEntry, entryIndex);
+          child = viewInt(&intEntry, 0); // left child of the entry
+
+        } else {
+          // move to the right child of the last entry of the block
+          // i.e numEntries - 1 th entry of the block
+          internalBlk.getEntryView(&intEntry, intHead->numEntries - 1);
+
+          child = viewInt(&intEntry, 4 + ATTR_SIZE); // right child of last entry
+        }
       }
-      /*if such an entry is found*/
-      if (entryIndex != -1) {
-        // move to the left child of that entry
-        internalBlk.getEntry(&intEntry, entryIndex);
-        block = intEntry.lChild; // left child of the entry
-
-      } else {
-        // move to the right child of the last entry of the block
-        // i.e numEntries - 1 th entry of the block
-        internalBlk.getEntry(&intEntry, intHead.numEntries - 1);
 
-        block = intEntry.rChild; // right child of last entry
+      if (read.validate()) {
+        break;
       }
     }
+
+    if (blockType != IND_INTERNAL) {
+      break;
+    }
+    block = child;
   }
 
   // NOTE: `block` now has the block number of a leaf index block.
@@ -172,50 +239,78 @@ RecId BPlusTree::bPlusSearch(int relId, char attrName[ATTR_SIZE],
   /******  Identify the first leaf index entry from the current position
               that satisfies our condition (moving right)             ******/
 
+  // (for EQ, LE and LT, no entry past one greater than attrVal satisfies the
+  // condition)
+  bool boundedAbove = predicate.isBoundedAbove();
+
   while (block != -1) {
     // load the block into leafBlk using IndLeaf::IndLeaf().
     IndLeaf leafBlk(block);
-    HeadInfo leafHead;
-
-    // load the header to leafHead using BlockBuffer::getHeader().
-    leafBlk.getHeader(&leafHead);
+    int rblock;
 
-    // declare leafEntry which will be used to store an entry from leafBlk
+    // declare leafEntry which will be used to store the entry found in leafBlk
     Index leafEntry;
 
-    /*while index < numEntries in leafBlk*/
-    while (index < leafHead.numEntries) {
-
-      // load entry corresponding to block and index into leafEntry
-      // using IndLeaf::getEntry().
-      leafBlk.getEntry(&leafEntry, index);
-
-      /* comparison between leafEntry's attribute value and input attrVal using
-        compareAttrs()*/
-      int cmpVal =
-          compareAttrs(leafEntry.attrVal, attrVal, attrCatEntry.attrType);
-
-      if ((op == EQ && cmpVal == 0) || (op == LE && cmpVal <= 0) ||
-          (op == LT && cmpVal < 0) || (op == GT && cmpVal > 0) ||
-          (op == GE && cmpVal >= 0) || (op == NE && cmpVal != 0)) {
-        // (entry satisfying the condition found)
-
-        // set search index to {block, index}
-        searchIndex = {block, index};
-        AttrCacheTable::setSearchIndex(relId, attrName, &searchIndex);
-
-        // return the recId {leafEntry.block, leafEntry.slot}.
-        return RecId{leafEntry.block, leafEntry.slot};
-      } else if ((op == EQ || op == LE || op == LT) && cmpVal > 0) {
-        /*future entries will not satisfy EQ, LE, LT since the values
-            are arranged in ascending order in the leaves */
-
-        // return RecId {-1, -1};
+    // the entries of the block are read optimistically as above; found is set
+    // if the entry at entryIndex satisfies the op, and done if no entry from
+    // there on can
+    bool found;
+    bool done;
+    int entryIndex;
+    for (int attempt = 0;; attempt++) {
+      OptimisticRead read(leafBlk, attempt);
+      if (read.getStatus() != SUCCESS) {
         return RecId{-1, -1};
       }
+      found = false;
+      done = false;
+
+      // get the header using BlockBuffer::getHeaderView().
+      const struct HeadInfo *leafHead;
+      leafBlk.getHeaderView(&leafHead);
+      rblock = leafHead->rblock;
+
+      /*while index < numEntries in leafBlk*/
+      for (entryIndex = index; entryIndex < leafHead->numEntries; entryIndex++) {
+
+        // view the entry corresponding to block and index using
+        // IndLeaf::getEntryView().
+        struct BlockView entry;
+        leafBlk.getEntryView(&entry, entryIndex);
+
+        /* test the entry's attribute value against the condition, with the
+          comparison the predicate was resolved into */
+        union Attribute entryVal = viewAttr(&entry, 0);
+
+        if (predicate.matches(entryVal)) {
+          // (entry satisfying the condition found: copy it into leafEntry)
+          memcpy(&leafEntry, entry.data, LEAF_ENTRY_SIZE);
+          found = true;
+          break;
+        } else if (boundedAbove && predicate.compare(entryVal) > 0) {
+          /*future entries will not satisfy EQ, LE, LT since the values
+              are arranged in ascending order in the leaves */
+          done = true;
+          break;
+        }
+      }
 
-      // search next index.
-      ++index;
+      if (read.validate()) {
+        break;
+      }
+    }
+
+    if (found) {
+      // set search index (the position of the cursor) to {block, index}
+      searchIndex = {block, entryIndex};
+      cursor->seek(searchIndex);
+
+      // return the recId {leafEntry.block, leafEntry.slot}.
+      return RecId{leafEntry.block, leafEntry.slot};
+    }
+    if (done) {
+      // return RecId {-1, -1};
+      return RecId{-1, -1};
     }
 
     /*only for NE operation do we have to check the entire linked list;
@@ -227,7 +322,7 @@ RecId BPlusTree::bPlusSearch(int relId, char attrName[ATTR_SIZE],
     }
 
     // block = next block in the linked list, i.e., the rblock in leafHead.
-    block = leafHead.rblock;
+    block = rblock;
     // update index to 0.
     index = 0;
   }
@@ -238,6 +333,9 @@ RecId BPlusTree::bPlusSearch(int relId, char attrName[ATTR_SIZE],
 
 int BPlusTree::bPlusCreate(int relId, char attrName[ATTR_SIZE]) {
 
+  // count the use of the buffer against the relation (see STATS)
+  RelationStatsScope statsScope(relId);
+
   // if relId is either RELCAT_RELID or ATTRCAT_RELID:
   //     return E_NOTPERMITTED;
   if (relId == RELCAT_RELID || relId == ATTRCAT_RELID) {
@@ -295,13 +393,18 @@ int BPlusTree::bPlusCreate(int relId, char attrName[ATTR_SIZE]) {
     // declare a RecBuffer object for `block` (using appropriate constructor)
     RecBuffer recBuffer(block);
 
-    unsigned char slotMap[relCatEntry.numSlotsPerBlk];
+    // (the number of slots is that of the block, which has more than
+    // numSlotsPerBlk if its slot map is a bitmap)
+    HeadInfo header;
+    recBuffer.getHeader(&header);
+
+    unsigned char slotMap[header.numSlots];
 
     // load the slot map into slotMap using RecBuffer::getSlotMap().
     recBuffer.getSlotMap(slotMap);
 
     // for every occupied slot of the block
-    for (int slot = 0; slot < relCatEntry.numSlotsPerBlk; slot++) {
+    for (int slot = 0; slot < header.numSlots; slot++) {
 
       if (slotMap[slot] == SLOT_UNOCCUPIED) {
         continue;
@@ -332,10 +435,6 @@ int BPlusTree::bPlusCreate(int relId, char attrName[ATTR_SIZE]) {
       }
     }
 
-    // get the header of the block using BlockBuffer::getHeader()
-    HeadInfo header;
-    recBuffer.getHeader(&header);
-
     // set block = rblock of current block (from the header)
     block = header.rblock;
   }
@@ -402,6 +501,9 @@ int BPlusTree::bPlusDestroy(int rootBlockNum) {
 
 int BPlusTree::bPlusInsert(int relId, char attrName[ATTR_SIZE],
                            Attribute attrVal, RecId recId) {
+  // count the use of the buffer against the relation (see STATS)
+  RelationStatsScope statsScope(relId);
+
   // get the attribute cache entry corresponding to attrName
   // using AttrCacheTable::getAttrCatEntry().
   AttrCatEntry attrCatEntry;
@@ -468,6 +570,7 @@ int BPlusTree::findLeafToInsert(int rootBlock, Attribute attrVal,
 
     // declare an IndInternal object for block using appropriate constructor
     IndInternal internalBlock(blockNum);
+    BlockPin pin(internalBlock);
 
     // get header of the block using BlockBuffer::getHeader()
     HeadInfo header;
@@ -519,6 +622,10 @@ int BPlusTree::insertIntoLeaf(int relId, char attrName[ATTR_SIZE], int blockNum,
   // declare an IndLeaf instance for the block using appropriate constructor
   IndLeaf leafBlock(blockNum);
 
+  // keep the block pinned while it is read and updated (the pin is released
+  // before the block is split, so that few pins are held at a time)
+  BlockPin pin(leafBlock);
+
   HeadInfo blockHeader;
   // store the header of the leaf index block into blockHeader
   // using BlockBuffer::getHeader()
@@ -584,13 +691,26 @@ int BPlusTree::insertIntoLeaf(int relId, char attrName[ATTR_SIZE], int blockNum,
     return SUCCESS;
   }
 
+  pin.release();
+
   // If we reached here, the `indices` array has more than entries than can fit
   // in a single leaf index block. Therefore, we will need to split the entries
   // in `indices` between two leaf blocks. We do this using the splitLeaf()
   // function. This function will return the blockNum of the newly allocated
   // block or E_DISKFULL if there are no more blocks to be allocated.
 
-  int newRightBlk = splitLeaf(blockNum, indices);
+  // the split may go up the tree (to the full internal blocks above the leaf,
+  // and a new root if they reach it): every block it needs is allocated here,
+  // at once, so that the tree is left as it was if the disk is full (rather
+  // than split half-way)
+  int numBlocks = countSplitBlocks(blockHeader.pblock);
+  int blockNums[numBlocks];
+  struct ClaimedBlocks claimed;
+  if (BlockBuffer::claimFreeBlocks('I', numBlocks, blockNums, &claimed) != SUCCESS) {
+    return E_DISKFULL;
+  }
+
+  int newRightBlk = splitLeaf(blockNum, indices, &claimed);
 
   // if splitLeaf() returned E_DISKFULL
   //     return E_DISKFULL
@@ -621,8 +741,8 @@ int BPlusTree::insertIntoLeaf(int relId, char attrName[ATTR_SIZE], int blockNum,
     internalEntry.lChild = blockNum;
     internalEntry.rChild = newRightBlk;
 
-    ret =
-        insertIntoInternal(relId, attrName, blockHeader.pblock, internalEntry);
+    ret = insertIntoInternal(relId, attrName, blockHeader.pblock, internalEntry,
+                             &claimed);
 
   } else {
     // the current block was the root block and is now split. a new internal
@@ -632,18 +752,42 @@ int BPlusTree::insertIntoLeaf(int relId, char attrName[ATTR_SIZE], int blockNum,
     // createNewRoot(relId, attrName, indices[MIDDLE_INDEX_LEAF].attrVal,
     //               current block, new right block)
     ret = createNewRoot(relId, attrName, indices[MIDDLE_INDEX_LEAF].attrVal,
-                        blockNum, newRightBlk);
+                        blockNum, newRightBlk, &claimed);
   }
 
+  // (the claimed blocks are all used, unless the tree changed meanwhile)
+  BlockBuffer::releaseClaimedBlocks(&claimed);
+
   // if either of the above calls returned an error (E_DISKFULL), then return
   // that else return SUCCESS
   return ret;
 }
 
-int BPlusTree::splitLeaf(int leafBlockNum, Index indices[]) {
-  // declare rightBlk, an instance of IndLeaf using constructor 1 to obtain new
-  // leaf index block that will be used as the right block in the splitting
-  IndLeaf rightBlk;
+/*
+Returns the number of blocks a split of a leaf block whose parent is pblock
+needs: the new leaf block, a new internal block for each full internal block
+above it (each of them is split in turn), and a new root if the split reaches
+the root.
+*/
+int BPlusTree::countSplitBlocks(int pblock) {
+  int numBlocks = 1;
+  while (pblock != INVALID_BLOCKNUM) {
+    IndInternal internalBlk(pblock);
+    HeadInfo header;
+    internalBlk.getHeader(&header);
+    if (header.numEntries != MAX_KEYS_INTERNAL) {
+      return numBlocks;
+    }
+    numBlocks++;
+    pblock = header.pblock;
+  }
+  return numBlocks + 1;
+}
+
+int BPlusTree::splitLeaf(int leafBlockNum, Index indices[], struct ClaimedBlocks *claimed) {
+  // declare rightBlk, an instance of IndLeaf taking the next of the claimed
+  // blocks, that will be used as the right block in the splitting
+  IndLeaf rightBlk(claimed);
 
   // declare leftBlk, an instance of IndLeaf using constructor 2 to read from
   // the existing leaf block
@@ -658,6 +802,10 @@ int BPlusTree::splitLeaf(int leafBlockNum, Index indices[]) {
     return E_DISKFULL;
   }
 
+  // keep both blocks pinned while their entries are written
+  BlockPin leftPin(leftBlk);
+  BlockPin rightPin(rightBlk);
+
   HeadInfo leftBlkHeader, rightBlkHeader;
   // get the headers of left block and right block using
   // BlockBuffer::getHeader()
@@ -697,7 +845,8 @@ int BPlusTree::splitLeaf(int leafBlockNum, Index indices[]) {
 }
 
 int BPlusTree::insertIntoInternal(int relId, char attrName[ATTR_SIZE],
-                                  int intBlockNum, InternalEntry intEntry) {
+                                  int intBlockNum, InternalEntry intEntry,
+                                  struct ClaimedBlocks *claimed) {
 
   // get the attribute cache entry corresponding to attrName
   // using AttrCacheTable::getAttrCatEntry().
@@ -785,7 +934,7 @@ int BPlusTree::insertIntoInternal(int relId, char attrName[ATTR_SIZE],
   // This function will return the blockNum of the newly allocated block or
   // E_DISKFULL if there are no more blocks to be allocated.
 
-  int newRightBlk = splitInternal(intBlockNum, internalEntries);
+  int newRightBlk = splitInternal(intBlockNum, internalEntries, claimed);
 
   /*if splitInternal() returned E_DISKFULL */
   if (newRightBlk == E_DISKFULL) {
@@ -823,7 +972,7 @@ int BPlusTree::insertIntoInternal(int relId, char attrName[ATTR_SIZE],
     newInternalEntry.attrVal = internalEntries[MIDDLE_INDEX_INTERNAL].attrVal;
 
     ret = insertIntoInternal(relId, attrName, blockHeader.pblock,
-                             newInternalEntry);
+                             newInternalEntry, claimed);
 
   } else {
     // the current block was the root block and is now split. a new internal
@@ -835,7 +984,7 @@ int BPlusTree::insertIntoInternal(int relId, char attrName[ATTR_SIZE],
     //               current block, new right block)
     ret = createNewRoot(relId, attrName,
                         internalEntries[MIDDLE_INDEX_INTERNAL].attrVal,
-                        intBlockNum, newRightBlk);
+                        intBlockNum, newRightBlk, claimed);
   }
 
   // if either of the above calls returned an error (E_DISKFULL), then return
@@ -843,11 +992,11 @@ int BPlusTree::insertIntoInternal(int relId, char attrName[ATTR_SIZE],
   return ret;
 }
 
-int BPlusTree::splitInternal(int intBlockNum, InternalEntry internalEntries[]) {
-  // declare rightBlk, an instance of IndInternal using constructor 1 to obtain
-  // new internal index block that will be used as the right block in the
-  // splitting
-  IndInternal rightBlk;
+int BPlusTree::splitInternal(int intBlockNum, InternalEntry internalEntries[],
+                             struct ClaimedBlocks *claimed) {
+  // declare rightBlk, an instance of IndInternal taking the next of the
+  // claimed blocks, that will be used as the right block in the splitting
+  IndInternal rightBlk(claimed);
 
   // declare leftBlk, an instance of IndInternal using constructor 2 to read
   // from the existing internal index block
@@ -927,15 +1076,16 @@ int BPlusTree::splitInternal(int intBlockNum, InternalEntry internalEntries[]) {
 }
 
 int BPlusTree::createNewRoot(int relId, char attrName[ATTR_SIZE],
-                             Attribute attrVal, int lChild, int rChild) {
+                             Attribute attrVal, int lChild, int rChild,
+                             struct ClaimedBlocks *claimed) {
   // get the attribute cache entry corresponding to attrName
   // using AttrCacheTable::getAttrCatEntry().
   AttrCatEntry attrCatEntry;
   AttrCacheTable::getAttrCatEntry(relId, attrName, &attrCatEntry);
 
-  // declare newRootBlk, an instance of IndInternal using appropriate
-  // constructor to allocate a new internal index block on the disk
-  IndInternal newRootBlk;
+  // declare newRootBlk, an instance of IndInternal taking the next of the
+  // claimed blocks for the new internal index block
+  IndInternal newRootBlk(claimed);
 
   int newRootBlkNum = newRootBlk.getBlockNum(); /* block number of newRootBlk */
 
@@ -2,24 +2,30 @@
 #define NITCBASE_BPLUSTREE_H
 
 #include "../Buffer/BlockBuffer.h"
+#include "../Buffer/Predicate.h"
 #include "../Buffer/StaticBuffer.h"
 #include "../Cache/OpenRelTable.h"
 #include "../define/constants.h"
 #include "../define/id.h"
+#include "IndexCursor.h"
 
 class BPlusTree {
  private:
   static int findLeafToInsert(int rootBlock, Attribute attrVal, int attrType);
   static int insertIntoLeaf(int relId, char attrName[ATTR_SIZE], int blockNum, Index entry);
-  static int splitLeaf(int leafBlockNum, Index indices[]);
-  static int insertIntoInternal(int relId, char attrName[ATTR_SIZE], int intBlockNum, InternalEntry entry);
-  static int splitInternal(int intBlockNum, InternalEntry internalEntries[]);
-  static int createNewRoot(int relId, char attrName[ATTR_SIZE], Attribute attrVal, int lChild, int rChild);
+  static int countSplitBlocks(int pblock);
+  static int splitLeaf(int leafBlockNum, Index indices[], struct ClaimedBlocks *claimed);
+  static int insertIntoInternal(int relId, char attrName[ATTR_SIZE], int intBlockNum, InternalEntry entry,
+                                struct ClaimedBlocks *claimed);
+  static int splitInternal(int intBlockNum, InternalEntry internalEntries[], struct ClaimedBlocks *claimed);
+  static int createNewRoot(int relId, char attrName[ATTR_SIZE], Attribute attrVal, int lChild, int rChild,
+                           struct ClaimedBlocks *claimed);
 
  public:
   static int bPlusCreate(int relId, char attrName[ATTR_SIZE]);
   static int bPlusInsert(int relId, char attrName[ATTR_SIZE], union Attribute attrVal, RecId recordId);
   static RecId bPlusSearch(int relId, char attrName[ATTR_SIZE], union Attribute attrVal, int op);
+  static RecId bPlusSearch(IndexCursor *cursor, int relId, char attrName[ATTR_SIZE], const Predicate &predicate);
   static int bPlusDestroy(int rootBlockNum);
 };
 
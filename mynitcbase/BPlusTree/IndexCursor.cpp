@@ -0,0 +1,21 @@
+#include "IndexCursor.h"
+
+// the declarations for this class can be found at "IndexCursor.h"
+
+IndexCursor::IndexCursor() {
+  start();
+}
+
+// used to start a search from the first entry of the tree
+void IndexCursor::start() {
+  this->position = IndexId{-1, -1};
+}
+
+// used to resume a search after the leaf entry indexId
+void IndexCursor::seek(IndexId indexId) {
+  this->position = indexId;
+}
+
+IndexId IndexCursor::getPosition() {
+  return this->position;
+}
@@ -0,0 +1,26 @@
+#ifndef NITCBASE_INDEXCURSOR_H
+#define NITCBASE_INDEXCURSOR_H
+
+#include "../define/id.h"
+
+/*
+ * Position of a search of the B+ tree of an attribute (see
+ * BPlusTree::bPlusSearch()): the leaf entry the last record found was taken
+ * from, or {-1, -1} before the first. Unlike the search index of the
+ * attribute in the attribute cache, a cursor carries its own position, so any
+ * number of searches of a tree may be in progress at a time.
+ */
+class IndexCursor {
+ private:
+  // field
+  IndexId position;
+
+ public:
+  // methods
+  IndexCursor();
+  void start();
+  void seek(IndexId indexId);
+  IndexId getPosition();
+};
+
+#endif  // NITCBASE_INDEXCURSOR_H
@@ -2,8 +2,23 @@
 
 #include <cstring>
 
+#include "../Config/Config.h"
+
+/*
+Used to search the relation for the next record satisfying the op, from its
+search index in the relation cache on (see the search below, which is given
+the relation's scan cursor, positioned at the search index); the search index
+is moved to the record found.
+*/
 RecId BlockAccess::linearSearch(int relId, char attrName[ATTR_SIZE],
                                 union Attribute attrVal, int op) {
+  // the condition is resolved for the type of the attribute (see Predicate)
+  AttrCatEntry attrCatEntry;
+  if (AttrCacheTable::getAttrCatEntry(relId, attrName, &attrCatEntry) != SUCCESS) {
+    return RecId{-1, -1};
+  }
+  Predicate predicate(attrCatEntry.attrType, op, attrVal);
+
   // get the previous search index of the relation relId from the relation cache
   // (use RelCacheTable::getSearchIndex() function)
   RecId prevRecId;
@@ -11,133 +26,109 @@ RecId BlockAccess::linearSearch(int relId, char attrName[ATTR_SIZE],
   // return code verification not done
   RelCacheTable::getSearchIndex(relId, &prevRecId);
 
-  // let block and slot denote the record id of the record being currently
-  // checked
-  int block;
-  int slot;
+  // the relation's scan cursor holds the block the search index is in, so
+  // that a search resumed there does not read the block again
+  ScanCursor *cursor;
+  RelCacheTable::getScanCursor(relId, &cursor);
 
   // if the current search index record is invalid(i.e. both block and slot =
   // -1)
   if (prevRecId.block == -1 && prevRecId.slot == -1) {
     // (no hits from previous search; search should start from the
     // first record itself)
-
-    // get the first record block of the relation from the relation cache
-    // (use RelCacheTable::getRelCatEntry() function of Cache Layer)
-    RelCatEntry relCatBuf;
-    RelCacheTable::getRelCatEntry(relId, &relCatBuf);
-
-    // block = first record block of the relation
-    // slot = 0
-    block = relCatBuf.firstBlk;
-    slot = 0;
+    cursor->open(relId);
   } else {
     // (there is a hit from previous search; search should start from
     // the record next to the search index record)
-
-    // block = search index's block
-    // slot = search index's slot + 1
-    block = prevRecId.block;
-    slot = prevRecId.slot + 1;
+    if (cursor->seek(prevRecId) != SUCCESS) {
+      return RecId{-1, -1};
+    }
   }
 
-  /* The following code searches for the next record in the relation
-     that satisfies the given condition
-     We start from the record id (block, slot) and iterate over the remaining
-     records of the relation
+  RecId recId = linearSearch(cursor, relId, attrName, predicate);
+
+  /*
+  set the search index in the relation cache as
+  the record id of the record that satisfies the given condition
+  (use RelCacheTable::setSearchIndex function)
   */
-  while (block != -1) {
-    /* create a RecBuffer object for block (use RecBuffer Constructor for
-       existing block) */
-    RecBuffer recBlock(block);
-
-    // get the record with id (block, slot) using RecBuffer::getRecord()
-    // get header of the block using RecBuffer::getHeader() function
-    // get slot map of the block using RecBuffer::getSlotMap() function
-
-    struct HeadInfo head;
-    // no return check
-    recBlock.getHeader(&head);
-
-    Attribute record[head.numAttrs];
-    // no return check
-    recBlock.getRecord(record, slot);
-
-    unsigned char slotMap[head.numSlots];
-    // no return check
-    recBlock.getSlotMap(slotMap);
-
-    // If slot >= the number of slots per block(i.e. no more slots in this
-    // block)
-    if (slot >= head.numSlots) {
-      // update block = right block of block
-      HeadInfo header;
-      recBlock.getHeader(&header);
-      block = header.rblock;
-      // update slot = 0
-      slot = 0;
-      continue; // continue to the beginning of this while loop
-    }
+  if (recId.block != -1) {
+    RelCacheTable::setSearchIndex(relId, &recId);
+  }
+  return recId;
+}
 
-    // if slot is free skip the loop
-    // (i.e. check if slot'th entry in slot map of block contains
-    // SLOT_UNOCCUPIED)
-    if (slotMap[slot] == SLOT_UNOCCUPIED) {
-      // increment slot and continue to the next record slot
-      slot++;
-      continue;
-    }
+/*
+Used to search the relation for the next record whose attribute attrName
+satisfies the predicate, from the position of the cursor on (see
+ScanCursor::open() to start from the first record). The cursor is moved past
+the record found.
+*/
+RecId BlockAccess::linearSearch(ScanCursor *cursor, int relId, char attrName[ATTR_SIZE],
+                                const Predicate &predicate) {
+  RecId recId;
+  union Attribute *record;
+  scanSearch(cursor, relId, attrName, predicate, &recId, &record);
+  return recId;
+}
 
-    // compare record's attribute value to the the given attrVal as below:
-    /*
-        firstly get the attribute offset for the attrName attribute
-        from the attribute cache entry of the relation using
-        AttrCacheTable::getAttrCatEntry()
-    */
+// (the search of linearSearch(), also giving the record found in *record, as
+// held by the cursor)
+int BlockAccess::scanSearch(ScanCursor *cursor, int relId, char attrName[ATTR_SIZE],
+                            const Predicate &predicate, RecId *recId,
+                            union Attribute **record) {
+  // count the use of the buffer against the relation (see STATS)
+  RelationStatsScope statsScope(relId);
 
-    AttrCatEntry attrCatBuff;
-    AttrCacheTable::getAttrCatEntry(relId, attrName, &attrCatBuff);
-    int attrOffset = attrCatBuff.offset;
+  *recId = RecId{-1, -1};
 
-    /* use the attribute offset to get the value of the attribute from
-       current record */
-    Attribute rec[head.numAttrs];
-    recBlock.getRecord(rec, slot);
-    Attribute attr = rec[attrOffset];
+  /* The following code searches for the next record in the relation
+     that satisfies the given condition
+     The records are scanned a block at a time by the cursor (each block is
+     read once, and its occupied records then checked out of the cursor),
+     from the record next to its position on
+  */
 
-    int cmpVal; // will store the difference between the attributes
-    // set cmpVal using compareAttrs()
-    cmpVal = compareAttrs(attr, attrVal, attrCatBuff.attrType);
+  // get the attribute offset for the attrName attribute from the attribute
+  // cache entry of the relation using AttrCacheTable::getAttrCatEntry()
+  // (it is the same for every record)
+  AttrCatEntry attrCatBuff;
+  int ret = AttrCacheTable::getAttrCatEntry(relId, attrName, &attrCatBuff);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+  int attrOffset = attrCatBuff.offset;
+
+  RecId nextRecId;
+  union Attribute *nextRecord;
+
+  // a condition on a NUMBER attribute is evaluated by the cursor for all the
+  // records of a block at once (see ScanCursor::nextMatch())
+  if (predicate.getAttrType() == NUMBER) {
+    ret = cursor->nextMatch(attrOffset, predicate.getOp(), predicate.getValue().nVal, &nextRecId,
+                            &nextRecord);
+    if (ret == SUCCESS) {
+      *recId = nextRecId;
+      *record = nextRecord;
+    }
+    return ret;
+  }
 
-    /* Next task is to check whether this record satisfies the given condition.
-       It is determined based on the output of previous comparison and
-       the op value received.
-       The following code sets the cond variable if the condition is satisfied.
+  // (the unoccupied slots are skipped by the cursor)
+  while ((ret = cursor->next(&nextRecId, &nextRecord)) == SUCCESS) {
+    /* check whether this record satisfies the given condition, with the
+       comparison the predicate was resolved into for the type of the
+       attribute and the op
     */
-    if ((op == NE && cmpVal != 0) || // if op is "not equal to"
-        (op == LT && cmpVal < 0) ||  // if op is "less than"
-        (op == LE && cmpVal <= 0) || // if op is "less than or equal to"
-        (op == EQ && cmpVal == 0) || // if op is "equal to"
-        (op == GT && cmpVal > 0) ||  // if op is "greater than"
-        (op == GE && cmpVal >= 0)    // if op is "greater than or equal to"
-    ) {
-      /*
-      set the search index in the relation cache as
-      the record id of the record that satisfies the given condition
-      (use RelCacheTable::setSearchIndex function)
-      */
-      RecId recId{block, slot};
-      RelCacheTable::setSearchIndex(relId, &recId);
-
-      // return RecId{block, slot};
-      return recId;
+    if (predicate.matches(nextRecord[attrOffset])) {
+      *recId = nextRecId;
+      *record = nextRecord;
+      return SUCCESS;
     }
-
-    slot++;
   }
 
   // no record in the relation with Id relid satisfies the given condition
-  return RecId{-1, -1};
+  return ret;
 }
 
 int BlockAccess::renameRelation(char oldName[ATTR_SIZE],
@@ -316,6 +307,9 @@ int BlockAccess::renameAttribute(char relName[ATTR_SIZE],
 }
 
 int BlockAccess::insert(int relId, Attribute *record) {
+  // count the use of the buffer against the relation (see STATS)
+  RelationStatsScope statsScope(relId);
+
   // get the relation catalog entry from relation cache
   // ( use RelCacheTable::getRelCatEntry() of Cache Layer)
   RelCatEntry relCatEntry;
@@ -344,26 +338,22 @@ int BlockAccess::insert(int relId, Attribute *record) {
   while (blockNum != -1) {
     // create a RecBuffer object for blockNum (using appropriate constructor!)
     RecBuffer recBuffer(blockNum);
+    BlockPin pin(recBuffer);
+    if (pin.getStatus() != SUCCESS) {
+      return pin.getStatus();
+    }
 
     // get header of block(blockNum) using RecBuffer::getHeader() function
     HeadInfo header;
     recBuffer.getHeader(&header);
 
-    // get slot map of block(blockNum) using RecBuffer::getSlotMap() function
-    unsigned char slotMap[header.numSlots];
-    recBuffer.getSlotMap(slotMap);
-
     // search for free slot in the block 'blockNum' and store it's rec-id in
-    // rec_id (Free slot can be found by iterating over the slot map of the
-    // block)
-    /* slot map stores SLOT_UNOCCUPIED if slot is free and
-       SLOT_OCCUPIED if slot is occupied) */
-    for (int i = 0; i < header.numSlots; i++) {
-      if (slotMap[i] == SLOT_UNOCCUPIED) {
-        rec_id.slot = i;
-        rec_id.block = blockNum;
-        break;
-      }
+    // rec_id (using RecBuffer::findFreeSlot(), which searches the slot map
+    // in place, a word at a time if it is a bitmap)
+    int freeSlot = recBuffer.findFreeSlot();
+    if (freeSlot >= 0) {
+      rec_id.slot = freeSlot;
+      rec_id.block = blockNum;
     }
 
     /* if a free slot is found, set rec_id and discontinue the traversal
@@ -393,8 +383,13 @@ int BlockAccess::insert(int relId, Attribute *record) {
     }
 
     // Otherwise,
-    // get a new record block (using the appropriate RecBuffer constructor!)
-    RecBuffer recBuffer;
+    // get a new record block (using the appropriate RecBuffer constructor!),
+    // the next of the blocks reserved for the relation so that its blocks
+    // follow each other on the disk
+    struct Extent extent;
+    RelCacheTable::getExtent(relId, &extent);
+    RecBuffer recBuffer(&extent);
+    RelCacheTable::setExtent(relId, &extent);
     // get the block number of the newly allocated block
     // (use BlockBuffer::getBlockNum() function)
     int ret = recBuffer.getBlockNum();
@@ -408,6 +403,19 @@ int BlockAccess::insert(int relId, Attribute *record) {
     rec_id.block = ret;
     rec_id.slot = 0;
 
+    // the slot map of the block is a bitmap if the session asks for one
+    // (see --slotmap), which leaves room for more slots than numOfSlots; the
+    // catalogs keep a byte per slot, as XFS reads them
+    bool bitmap = Config::slotMapFormat == SLOTMAP_BITMAP && relId != RELCAT_RELID &&
+                  relId != ATTRCAT_RELID;
+    int numSlots = bitmap ? RecBuffer::getNumSlots(numOfAttributes, true) : numOfSlots;
+
+    // keep the new block pinned while it is set up
+    BlockPin pin(recBuffer);
+    if (pin.getStatus() != SUCCESS) {
+      return pin.getStatus();
+    }
+
     /*
         set the header of the new record block such that it links with
         existing record blocks of the relation
@@ -418,7 +426,7 @@ int BlockAccess::insert(int relId, Attribute *record) {
                      i.e this is the first insertion into the relation)
               = prevBlockNum (otherwise),
         rblock: -1, numEntries: 0,
-        numSlots: numOfSlots, numAttrs: numOfAttributes
+        numSlots: numSlots, numAttrs: numOfAttributes
         (use BlockBuffer::setHeader() function)
     */
     HeadInfo header;
@@ -427,29 +435,23 @@ int BlockAccess::insert(int relId, Attribute *record) {
     header.lblock = prevBlockNum; // doubts here
     header.rblock = -1;
     header.numEntries = 0;
-    header.numSlots = numOfSlots;
+    header.numSlots = numSlots;
     header.numAttrs = numOfAttributes;
 
     recBuffer.setHeader(&header);
 
     /*
         set block's slot map with all slots marked as free
-        (i.e. store SLOT_UNOCCUPIED for all the entries)
-        (use RecBuffer::setSlotMap() function)
+        (i.e. store SLOT_UNOCCUPIED for all the entries, or clear every bit)
+        (use RecBuffer::initSlotMap() function)
     */
-
-    unsigned char slotMap[numOfSlots];
-
-    for (int i = 0; i < numOfSlots; i++) {
-      slotMap[i] = SLOT_UNOCCUPIED;
-    }
-
-    recBuffer.setSlotMap(slotMap);
+    recBuffer.initSlotMap(bitmap);
 
     // if prevBlockNum != -1
     if (prevBlockNum != -1) {
       // create a RecBuffer object for prevBlockNum
       RecBuffer prevRecBuffer(prevBlockNum);
+      BlockPin prevPin(prevRecBuffer);
 
       // get the header of the block prevBlockNum and
       // update the rblock field of the header to the new block
@@ -482,11 +484,8 @@ int BlockAccess::insert(int relId, Attribute *record) {
   /* update the slot map of the block by marking entry of the slot to
      which record was inserted as occupied) */
   // (ie store SLOT_OCCUPIED in free_slot'th entry of slot map)
-  // (use RecBuffer::getSlotMap() and RecBuffer::setSlotMap() functions)
-  unsigned char slotMap[numOfSlots];
-  newRecBuffer.getSlotMap(slotMap);
-  slotMap[rec_id.slot] = SLOT_OCCUPIED;
-  newRecBuffer.setSlotMap(slotMap);
+  // (use RecBuffer::setSlotState() function)
+  newRecBuffer.setSlotState(rec_id.slot, SLOT_OCCUPIED);
 
   // increment the numEntries field in the header of the block to
   // which record was inserted
@@ -542,6 +541,9 @@ NOTE: This function will copy the result of the search to the `record` argument.
 */
 int BlockAccess::search(int relId, Attribute *record, char attrName[ATTR_SIZE],
                         Attribute attrVal, int op) {
+  // count the use of the buffer against the relation (see STATS)
+  RelationStatsScope statsScope(relId);
+
   // Declare a variable called recid to store the searched record
   RecId recId;
 
@@ -594,6 +596,49 @@ int BlockAccess::search(int relId, Attribute *record, char attrName[ATTR_SIZE],
   return SUCCESS;
 }
 
+/*
+Used to search the relation for the next record whose attribute attrName
+satisfies the predicate, from the position of the cursor on (as search() does
+from the search indices), copying it to `record`. The index of the attribute is
+searched with the index cursor if the attribute has one; else the relation is
+scanned with the scan cursor.
+*/
+int BlockAccess::search(SearchCursor *cursor, int relId, Attribute *record,
+                        char attrName[ATTR_SIZE], const Predicate &predicate) {
+  // count the use of the buffer against the relation (see STATS)
+  RelationStatsScope statsScope(relId);
+
+  AttrCatEntry attrCatEntry;
+  int ret = AttrCacheTable::getAttrCatEntry(relId, attrName, &attrCatEntry);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  if (attrCatEntry.rootBlock == INVALID_BLOCKNUM) {
+    // (the scan cursor holds a copy of the record found)
+    RecId recId;
+    union Attribute *found;
+    ret = scanSearch(&cursor->scan, relId, attrName, predicate, &recId, &found);
+    if (ret != SUCCESS) {
+      return E_NOTFOUND;
+    }
+    RelCatEntry relCatEntry;
+    RelCacheTable::getRelCatEntry(relId, &relCatEntry);
+    memcpy(record, found, relCatEntry.numAttrs * ATTR_SIZE);
+    return SUCCESS;
+  }
+
+  RecId recId = BPlusTree::bPlusSearch(&cursor->index, relId, attrName, predicate);
+  if (recId.block == -1 && recId.slot == -1) {
+    return E_NOTFOUND;
+  }
+
+  RecBuffer recBuffer(recId.block);
+  recBuffer.getRecord(record, recId.slot);
+
+  return SUCCESS;
+}
+
 int BlockAccess::deleteRelation(char relName[ATTR_SIZE]) {
   // if the relation to delete is either Relation Catalog or Attribute Catalog,
   //     return E_NOTPERMITTED
@@ -901,6 +946,9 @@ int BlockAccess::deleteRelation(char relName[ATTR_SIZE]) {
 NOTE: the caller is expected to allocate space for the argument `record` based
       on the size of the relation. This function will only copy the result of
       the projection onto the array pointed to by the argument.
+Gives the record next to the search index of the relation (see the project
+below, which is given the relation's scan cursor, positioned at it), and moves
+the search index to it.
 */
 int BlockAccess::project(int relId, Attribute *record) {
   // get the previous search index of the relation relId from the relation
@@ -908,87 +956,66 @@ int BlockAccess::project(int relId, Attribute *record) {
   RecId prevRecId;
   RelCacheTable::getSearchIndex(relId, &prevRecId);
 
-  // declare block and slot which will be used to store the record id of the
-  // slot we need to check.
-  int block, slot;
+  // the records are read a block at a time with the relation's scan cursor
+  // (see ScanCursor), as in linearSearch()
+  ScanCursor *cursor;
+  RelCacheTable::getScanCursor(relId, &cursor);
 
   /* if the current search index record is invalid(i.e. = {-1, -1})
      (this only happens when the caller reset the search index)
   */
   if (prevRecId.block == -1 && prevRecId.slot == -1) {
     // (new project operation. start from beginning)
-
-    // get the first record block of the relation from the relation cache
-    // (use RelCacheTable::getRelCatEntry() function of Cache Layer)
-    RelCatEntry relCatEntry;
-    RelCacheTable::getRelCatEntry(relId, &relCatEntry);
-
-    // block = first record block of the relation
-    block = relCatEntry.firstBlk;
-    // slot = 0
-    slot = 0;
-
+    cursor->open(relId);
   } else {
     // (a project/search operation is already in progress)
 
-    // block = previous search index's block
-    block = prevRecId.block;
-    // slot = previous search index's slot + 1
-    slot = prevRecId.slot + 1;
-  }
-
-  // The following code finds the next record of the relation
-  /* Start from the record id (block, slot) and iterate over the remaining
-     records of the relation */
-  while (block != -1) {
-    // create a RecBuffer object for block (using appropriate constructor!)
-    RecBuffer recBuffer(block);
-
-    // get header of the block using RecBuffer::getHeader() function
-    HeadInfo header;
-    recBuffer.getHeader(&header);
-    // get slot map of the block using RecBuffer::getSlotMap() function
-    unsigned char slotmap[header.numSlots];
-    recBuffer.getSlotMap(slotmap);
-
-    /* slot >= the number of slots per block*/
-    if (slot >= header.numSlots) {
-      // (no more slots in this block)
-      // update block = right block of block
-      block = header.rblock;
-      // update slot = 0
-      slot = 0;
-      // (NOTE: if this is the last block, rblock would be -1. this would
-      //        set block = -1 and fail the loop condition )
-
-    } else if /* slot is free */ (slotmap[slot] == SLOT_UNOCCUPIED) {
-      // (i.e slot-th entry in slotMap contains
-      // SLOT_UNOCCUPIED)
-      // increment slot
-      slot++;
-    } else {
-      // (the next occupied slot / record has been found)
-      break;
+    // resume the scan after the previous search index
+    if (cursor->seek(prevRecId) != SUCCESS) {
+      return E_NOTFOUND;
     }
   }
 
-  if (block == -1) {
-    // (a record was not found. all records exhausted)
-    return E_NOTFOUND;
+  RecId nextRecId;
+  int ret = project(cursor, relId, record, &nextRecId);
+  if (ret != SUCCESS) {
+    return ret;
   }
 
-  // declare nextRecId to store the RecId of the record found
-  RecId nextRecId{block, slot};
-
   // set the search index to nextRecId using RelCacheTable::setSearchIndex
   RelCacheTable::setSearchIndex(relId, &nextRecId);
 
+  return SUCCESS;
+}
+
+/*
+Used to copy the record next to the position of the cursor into `record` (and
+its record id into *recId, if it is not null), moving the cursor past it.
+Returns E_NOTFOUND once every record of the relation has been given.
+*/
+int BlockAccess::project(ScanCursor *cursor, int relId, Attribute *record, RecId *recId) {
+  // count the use of the buffer against the relation (see STATS)
+  RelationStatsScope statsScope(relId);
+
+  // The following code finds the next record of the relation
+  // (the cursor skips the unoccupied slots and moves on to the right block of
+  // each block)
+  RecId nextRecId;
+  union Attribute *nextRecord;
+  if (cursor->next(&nextRecId, &nextRecord) != SUCCESS) {
+    // (a record was not found. all records exhausted)
+    return E_NOTFOUND;
+  }
+
   /* Copy the record with record id (nextRecId) to the record buffer (record)
-     For this Instantiate a RecBuffer class object by passing the recId and
-     call the appropriate method to fetch the record
+     (the cursor holds a copy of the records of the block)
   */
-  RecBuffer recBuffer(block);
-  recBuffer.getRecord(record, slot);
+  RelCatEntry relCatEntry;
+  RelCacheTable::getRelCatEntry(relId, &relCatEntry);
+  memcpy(record, nextRecord, relCatEntry.numAttrs * ATTR_SIZE);
 
+  if (recId != nullptr) {
+    *recId = nextRecId;
+  }
   return SUCCESS;
 }
@@ -2,16 +2,38 @@
 #define NITCBASE_BLOCKACCESS_H
 
 #include "../BPlusTree/BPlusTree.h"
+#include "../BPlusTree/IndexCursor.h"
 #include "../Buffer/BlockBuffer.h"
+#include "../Buffer/Predicate.h"
 #include "../Cache/AttrCacheTable.h"
 #include "../Cache/RelCacheTable.h"
 #include "../define/constants.h"
 #include "../define/id.h"
+#include "ScanCursor.h"
+
+/*
+ * Position of a search of a relation (see BlockAccess::search()): of the scan
+ * of its records, or of the search of the index of the attribute searched.
+ * Unlike the search indices in the caches, a cursor belongs to the search, so
+ * any number of searches of a relation may be in progress at a time.
+ * (a search is started with scan.open() and index.start())
+ */
+struct SearchCursor {
+  ScanCursor scan;
+  IndexCursor index;
+};
 
 class BlockAccess {
+ private:
+  static int scanSearch(ScanCursor *cursor, int relId, char *attrName,
+                        const Predicate &predicate, RecId *recId, union Attribute **record);
+
  public:
   static int search(int relId, Attribute *record, char *attrName, Attribute attrVal, int op);
 
+  static int search(SearchCursor *cursor, int relId, Attribute *record, char *attrName,
+                    const Predicate &predicate);
+
   static int insert(int relId, union Attribute *record);
 
   static int renameRelation(char *oldName, char *newName);
@@ -22,7 +44,12 @@ class BlockAccess {
 
   static RecId linearSearch(int relId, char *attrName, Attribute attrVal, int op);
 
+  static RecId linearSearch(ScanCursor *cursor, int relId, char *attrName,
+                            const Predicate &predicate);
+
   static int project(int relId, Attribute *record);
+
+  static int project(ScanCursor *cursor, int relId, Attribute *record, RecId *recId = nullptr);
 };
 
 #endif  // NITCBASE_BLOCKACCESS_H
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "RecordFilter.h"
+
+#include <cstring>
+
+#include "../Buffer/Predicate.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RECORD_FILTER_X86
+#endif
+
+// the declarations for this class can be found at "RecordFilter.h"
+
+// (values: the attribute of the first record, stride: doubles from the
+// attribute of a record to that of the next)
+template <int OP>
+static void filterScalar(const double *values, int stride, int first, int numRecords, double value,
+                         uint64_t selection[]) {
+  for (int i = first; i < numRecords; i++) {
+    selection[i / 64] |= (uint64_t)matchesNumber<OP>(values[(long)i * stride], value) << (i % 64);
+  }
+}
+
+#ifdef RECORD_FILTER_X86
+
+static bool hasAVX2() {
+  static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+  return avx2;
+}
+
+// (the comparison predicates, as in matchesNumber())
+template <int OP>
+__attribute__((target("avx2"))) static inline __m256d compareAVX2(__m256d recordValues,
+                                                                  __m256d value) {
+  switch (OP) {
+    case EQ:
+      return _mm256_cmp_pd(recordValues, value, _CMP_EQ_UQ);
+    case NE:
+      return _mm256_cmp_pd(recordValues, value, _CMP_NEQ_OQ);
+    case LT:
+      return _mm256_cmp_pd(recordValues, value, _CMP_LT_OQ);
+    case LE:
+      return _mm256_cmp_pd(recordValues, value, _CMP_NGT_UQ);
+    case GT:
+      return _mm256_cmp_pd(recordValues, value, _CMP_GT_OQ);
+    default:  // GE
+      return _mm256_cmp_pd(recordValues, value, _CMP_NLT_UQ);
+  }
+}
+
+// four records at a time: the attribute of each is gathered into a vector
+template <int OP>
+__attribute__((target("avx2"))) static void filterAVX2(const double *values, int stride,
+                                                       int numRecords, double value,
+                                                       uint64_t selection[]) {
+  __m256i offsets = _mm256_set_epi64x(3L * stride, 2L * stride, stride, 0);
+  __m256d constant = _mm256_set1_pd(value);
+
+  int i = 0;
+  for (; i + 4 <= numRecords; i += 4) {
+    __m256d recordValues = _mm256_i64gather_pd(values + (long)i * stride, offsets, 8);
+    uint64_t mask = _mm256_movemask_pd(compareAVX2<OP>(recordValues, constant));
+    // (4 divides 64, so the bits of a step are in the same word)
+    selection[i / 64] |= mask << (i % 64);
+  }
+  filterScalar<OP>(values, stride, i, numRecords, value, selection);
+}
+
+template <int OP>
+static inline __m128d compareSSE2(__m128d recordValues, __m128d value) {
+  switch (OP) {
+    case EQ:
+      return _mm_or_pd(_mm_cmpeq_pd(recordValues, value), _mm_cmpunord_pd(recordValues, value));
+    case NE:
+      return _mm_or_pd(_mm_cmplt_pd(recordValues, value), _mm_cmpgt_pd(recordValues, value));
+    case LT:
+      return _mm_cmplt_pd(recordValues, value);
+    case LE:
+      return _mm_cmpngt_pd(recordValues, value);
+    case GT:
+      return _mm_cmpgt_pd(recordValues, value);
+    default:  // GE
+      return _mm_cmpnlt_pd(recordValues, value);
+  }
+}
+
+// two records at a time (SSE2 is there on every x86-64 processor)
+template <int OP>
+static void filterSSE2(const double *values, int stride, int numRecords, double value,
+                       uint64_t selection[]) {
+  __m128d constant = _mm_set1_pd(value);
+
+  int i = 0;
+  for (; i + 2 <= numRecords; i += 2) {
+    const double *recordValue = values + (long)i * stride;
+    __m128d recordValues = _mm_set_pd(recordValue[stride], recordValue[0]);
+    uint64_t mask = _mm_movemask_pd(compareSSE2<OP>(recordValues, constant));
+    selection[i / 64] |= mask << (i % 64);
+  }
+  filterScalar<OP>(values, stride, i, numRecords, value, selection);
+}
+
+#endif  // RECORD_FILTER_X86
+
+template <int OP>
+static void filter(const double *values, int stride, int numRecords, double value,
+                   uint64_t selection[]) {
+#ifdef RECORD_FILTER_X86
+  if (hasAVX2()) {
+    filterAVX2<OP>(values, stride, numRecords, value, selection);
+  } else {
+    filterSSE2<OP>(values, stride, numRecords, value, selection);
+  }
+#else
+  filterScalar<OP>(values, stride, 0, numRecords, value, selection);
+#endif
+}
+
+/*
+Used to evaluate the condition (attribute attrOffset of a record op value) for
+the numRecords records (of numAttrs attributes each) at `records`, into the
+bitmap `selection`. Returns the number of records satisfying the condition.
+*/
+int RecordFilter::filterNumber(const union Attribute *records, int numRecords, int numAttrs,
+                               int attrOffset, int op, double value,
+                               uint64_t selection[SELECTION_WORDS]) {
+  memset(selection, 0, SELECTION_WORDS * sizeof(uint64_t));
+  if (numRecords <= 0) {
+    return 0;
+  }
+
+  // (the attribute is at the same offset in every record, so its values are
+  // numAttrs attributes apart)
+  const double *values = &records[attrOffset].nVal;
+  int stride = numAttrs * ATTR_SIZE / sizeof(double);
+
+  switch (op) {
+    case EQ:
+      filter<EQ>(values, stride, numRecords, value, selection);
+      break;
+    case NE:
+      filter<NE>(values, stride, numRecords, value, selection);
+      break;
+    case LT:
+      filter<LT>(values, stride, numRecords, value, selection);
+      break;
+    case LE:
+      filter<LE>(values, stride, numRecords, value, selection);
+      break;
+    case GT:
+      filter<GT>(values, stride, numRecords, value, selection);
+      break;
+    case GE:
+      filter<GE>(values, stride, numRecords, value, selection);
+      break;
+    default:
+      return 0;
+  }
+
+  int numSelected = 0;
+  for (int word = 0; word < SELECTION_WORDS; word++) {
+    numSelected += __builtin_popcountll(selection[word]);
+  }
+  return numSelected;
+}
@@ -0,0 +1,30 @@
+#ifndef NITCBASE_RECORDFILTER_H
+#define NITCBASE_RECORDFILTER_H
+
+#include <cstdint>
+
+#include "../Buffer/BlockBuffer.h"
+#include "../define/constants.h"
+
+// number of words of a selection bitmap (a bit for each record of a block)
+#define SELECTION_WORDS ((MAX_SLOTS_PER_BLOCK + 63) / 64)
+
+/*
+ * Evaluates a condition (attribute op value) on a NUMBER attribute for all the
+ * records of a block at once, into a selection bitmap: bit i (of word i / 64)
+ * is set if the i-th record satisfies the condition. The records are those
+ * copied out of a block by ScanCursor, one after the other.
+ * The comparisons are done four records at a time with AVX2 where the
+ * processor has it, else two at a time with SSE2, else one at a time (without
+ * branching on their outcome in any case), and agree with compareAttrs() on
+ * every value, NaN included.
+ */
+class RecordFilter {
+ public:
+  // methods
+  static int filterNumber(const union Attribute *records, int numRecords, int numAttrs,
+                          int attrOffset, int op, double value,
+                          uint64_t selection[SELECTION_WORDS]);
+};
+
+#endif  // NITCBASE_RECORDFILTER_H
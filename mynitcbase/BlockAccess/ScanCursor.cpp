@@ -0,0 +1,250 @@
+#include "ScanCursor.h"
+
+#include <cstring>
+
+#include "../Cache/RelCacheTable.h"
+
+// the declarations for this class can be found at "ScanCursor.h"
+
+ScanCursor::ScanCursor() {
+  start(-1);
+}
+
+/*
+Used to start a scan of the records of the open relation relId. Returns
+SUCCESS, or the error if the relation is not open.
+*/
+int ScanCursor::open(int relId) {
+  RelCatEntry relCatEntry;
+  int ret = RelCacheTable::getRelCatEntry(relId, &relCatEntry);
+  if (ret != SUCCESS) {
+    start(-1);
+    return ret;
+  }
+  start(relCatEntry.firstBlk);
+  return SUCCESS;
+}
+
+/*
+Used to start a scan of the records of the relation whose first record block
+is firstBlock (a scan of no blocks if it is -1).
+*/
+void ScanCursor::start(int firstBlock) {
+  this->blockNum = -1;
+  this->rblock = firstBlock;
+  this->numAttrs = 0;
+  this->numRecords = 0;
+  this->position = 0;
+  this->bufferNum = -1;
+  this->filtered = false;
+}
+
+/*
+Used to resume a scan after the record recId: next() gives the records that
+follow it. The records of its block are kept if the block was not changed
+since they were read; else the block is read again.
+Returns SUCCESS, or the error if the block could not be read.
+*/
+int ScanCursor::seek(RecId recId) {
+  if (recId.block != this->blockNum ||
+      !OptimisticRead::isUnchanged(this->bufferNum, this->version)) {
+    int ret = readBlock(recId.block);
+    if (ret != SUCCESS) {
+      start(-1);
+      return ret;
+    }
+  }
+
+  // (the occupied slots are in order)
+  this->position = 0;
+  while (this->position < this->numRecords && this->slots[this->position] <= recId.slot) {
+    this->position++;
+  }
+  return SUCCESS;
+}
+
+/*
+Used to get the next record of the scan: its record id in *recId, and the
+record itself in *record (which stays valid until the cursor reads another
+block). Returns SUCCESS, E_NOTFOUND once every record has been given, or the
+error if a block could not be read.
+*/
+int ScanCursor::next(RecId *recId, union Attribute **record) {
+  while (this->position >= this->numRecords) {
+    int ret = nextBlock();
+    if (ret != SUCCESS) {
+      return ret;
+    }
+  }
+
+  *recId = RecId{this->blockNum, this->slots[this->position]};
+  *record = getRecord(this->position);
+  this->position++;
+  return SUCCESS;
+}
+
+/*
+Used to get the next record of the scan whose NUMBER attribute at attrOffset
+satisfies the condition (attribute op value), as next() does for every record.
+The condition is evaluated for every record of a block as it is read (unless
+it was for the same condition already), and the records satisfying it are then
+found in the selection a word at a time.
+*/
+int ScanCursor::nextMatch(int attrOffset, int op, double value, RecId *recId,
+                          union Attribute **record) {
+  while (true) {
+    if (this->position >= this->numRecords) {
+      int ret = nextBlock();
+      if (ret != SUCCESS) {
+        return ret;
+      }
+      continue;
+    }
+
+    if (!this->filtered || this->filterOffset != attrOffset || this->filterOp != op ||
+        memcmp(&this->filterValue, &value, sizeof(double)) != 0) {
+      RecordFilter::filterNumber(this->records, this->numRecords, this->numAttrs, attrOffset, op,
+                                 value, this->selection);
+      this->filtered = true;
+      this->filterOffset = attrOffset;
+      this->filterOp = op;
+      this->filterValue = value;
+    }
+
+    // the first record selected from the position on (the bits of the records
+    // before it are masked off its word)
+    for (int word = this->position / 64; word < SELECTION_WORDS; word++) {
+      uint64_t bits = this->selection[word];
+      if (word == this->position / 64) {
+        bits &= ~(uint64_t)0 << (this->position % 64);
+      }
+      if (bits != 0) {
+        int index = word * 64 + __builtin_ctzll(bits);
+        *recId = RecId{this->blockNum, this->slots[index]};
+        *record = getRecord(index);
+        this->position = index + 1;
+        return SUCCESS;
+      }
+    }
+
+    // (no more records of the block are selected)
+    this->position = this->numRecords;
+  }
+}
+
+/*
+Used to move on to the next record block of the relation, whose occupied
+records are then given by getNumRecords(), getSlot() and getRecord() (and
+next()). Returns SUCCESS, E_NOTFOUND after the last block, or the error if the
+block could not be read.
+*/
+int ScanCursor::nextBlock() {
+  if (this->rblock == -1) {
+    this->position = this->numRecords;
+    return E_NOTFOUND;
+  }
+  int ret = readBlock(this->rblock);
+  if (ret != SUCCESS) {
+    start(-1);
+    return ret;
+  }
+  this->position = 0;
+  return SUCCESS;
+}
+
+int ScanCursor::getBlockNum() {
+  return this->blockNum;
+}
+
+int ScanCursor::getNumRecords() {
+  return this->numRecords;
+}
+
+// slot of the index-th occupied record of the block
+int ScanCursor::getSlot(int index) {
+  return this->slots[index];
+}
+
+// the index-th occupied record of the block
+union Attribute *ScanCursor::getRecord(int index) {
+  return this->records + index * this->numAttrs;
+}
+
+/*
+Used to read the header, the slot map and the occupied records of a record
+block into the cursor, with a single (optimistic) read of the block. The slot
+map may be either a byte per slot or a bitmap (see RecBuffer::hasBitmapSlotMap()).
+*/
+int ScanCursor::readBlock(int blockNum) {
+  RecBuffer recBuffer(blockNum);
+
+  for (int attempt = 0;; attempt++) {
+    OptimisticRead read(recBuffer, attempt);
+    if (read.getStatus() != SUCCESS) {
+      return read.getStatus();
+    }
+
+    const struct HeadInfo *head;
+    recBuffer.getHeaderView(&head);
+    int numSlots = head->numSlots;
+    int numAttrs = head->numAttrs;
+    int rblock = head->rblock;
+    int recordSize = numAttrs * ATTR_SIZE;
+
+    // (a block that is not a record block, or was being changed as the read
+    // began, is not read)
+    if (head->blockType != REC || numSlots < 0 || numSlots > MAX_SLOTS_PER_BLOCK ||
+        numAttrs <= 0 ||
+        RecBuffer::getSlotMapSize(head) + numSlots * recordSize > BLOCK_SIZE - HEADER_SIZE) {
+      if (read.validate()) {
+        return E_INVALIDBLOCK;
+      }
+      continue;
+    }
+
+    struct BlockView slotMap;
+    recBuffer.getSlotMapView(&slotMap);
+
+    int numRecords = 0;
+    if (!RecBuffer::hasBitmapSlotMap(head)) {
+      for (int slot = 0; slot < numSlots; slot++) {
+        if (slotMap.data[slot] == SLOT_UNOCCUPIED) {
+          continue;
+        }
+        struct BlockView record;
+        recBuffer.getRecordView(&record, slot);
+        memcpy(this->records + numRecords * numAttrs, record.data, record.length);
+        this->slots[numRecords] = slot;
+        numRecords++;
+      }
+    } else {
+      // (the occupied slots of a bitmap are found a word at a time, the lowest
+      // set bit of the word being the next of them)
+      for (int word = 0; word * 64 < numSlots; word++) {
+        uint64_t occupied = viewSlotWord(&slotMap, word);
+        while (occupied != 0) {
+          int slot = word * 64 + __builtin_ctzll(occupied);
+          occupied &= occupied - 1;
+          if (slot >= numSlots) {
+            break;
+          }
+          struct BlockView record;
+          recBuffer.getRecordView(&record, slot);
+          memcpy(this->records + numRecords * numAttrs, record.data, record.length);
+          this->slots[numRecords] = slot;
+          numRecords++;
+        }
+      }
+    }
+
+    if (read.validate()) {
+      this->blockNum = blockNum;
+      this->rblock = rblock;
+      this->numAttrs = numAttrs;
+      this->numRecords = numRecords;
+      this->filtered = false;
+      this->bufferNum = read.getBufferNum(&this->version);
+      return SUCCESS;
+    }
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef NITCBASE_SCANCURSOR_H
+#define NITCBASE_SCANCURSOR_H
+
+#include "../Buffer/BlockBuffer.h"
+#include "../define/constants.h"
+#include "../define/id.h"
+#include "RecordFilter.h"
+
+/*
+ * Cursor scanning the record blocks of a relation a block at a time. Each block
+ * is looked up in the buffer once: its header, its slot map and its occupied
+ * records are read together, through a single OptimisticRead, and the records
+ * are then handed out of the cursor (next(), or getNumRecords(), getSlot() and
+ * getRecord() for the block as a whole) without going back to the buffer.
+ * The records are copied out of the buffer, so that the block is neither
+ * pinned nor latched while they are used.
+ * The cursor remembers the buffer and version the block was read from, so that
+ * a scan resumed at a record of the block (see seek()) only reads the block
+ * again if it was changed (or replaced) meanwhile.
+ * A cursor carries the position of its scan itself, so any number of scans of
+ * a relation may be in progress at a time (see BlockAccess::linearSearch());
+ * a scan sees the records of a block as they were when the block was read.
+ * A search on a NUMBER attribute (see nextMatch()) evaluates its condition for
+ * all the records of a block at once (see RecordFilter), and keeps the
+ * selection for as long as the block is kept.
+ */
+class ScanCursor {
+ private:
+  // fields
+  int blockNum;    // block the records are from (-1 if none is read)
+  int rblock;      // block after it (-1 after the last block)
+  int numAttrs;
+  int numRecords;  // number of occupied slots of the block
+  int position;    // index of the record next() gives next
+  // buffer the block was read from, and its version then
+  int bufferNum;
+  unsigned int version;
+  // the occupied slots, in order, and their records (the i-th at
+  // records + i * numAttrs)
+  int slots[MAX_SLOTS_PER_BLOCK];
+  union Attribute records[(BLOCK_SIZE - HEADER_SIZE) / ATTR_SIZE];
+  // the condition last evaluated for the records (see nextMatch()), and the
+  // records satisfying it (bit i for the i-th record)
+  bool filtered;
+  int filterOffset;
+  int filterOp;
+  double filterValue;
+  uint64_t selection[SELECTION_WORDS];
+
+  // methods
+  int readBlock(int blockNum);
+
+ public:
+  // methods
+  ScanCursor();
+  int open(int relId);
+  void start(int firstBlock);
+  int seek(RecId recId);
+  int next(RecId *recId, union Attribute **record);
+  int nextMatch(int attrOffset, int op, double value, RecId *recId, union Attribute **record);
+  int nextBlock();
+  int getBlockNum();
+  int getNumRecords();
+  int getSlot(int index);
+  union Attribute *getRecord(int index);
+};
+
+#endif  // NITCBASE_SCANCURSOR_H
@@ -0,0 +1,71 @@
+#include "AccessTrace.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "../Config/Config.h"
+
+// the declarations for this class can be found at "AccessTrace.h"
+
+FILE *AccessTrace::file = nullptr;
+std::mutex AccessTrace::lock;
+uint32_t AccessTrace::records[TRACE_BATCH];
+int AccessTrace::numRecords = 0;
+
+/*
+The trace file named with --trace is created (replacing any older one) and its
+header written. If it cannot be created the session goes on untraced.
+*/
+AccessTrace::AccessTrace() {
+  if (Config::traceFile == nullptr) {
+    return;
+  }
+
+  file = fopen(Config::traceFile, "wb");
+  if (file == nullptr) {
+    std::cout << "Could not create the trace file " << Config::traceFile << std::endl;
+    return;
+  }
+
+  struct TraceHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.bufferCapacity = Config::bufferCapacity;
+  header.replacementPolicy = Config::replacementPolicy;
+  header.readAheadBlocks = Config::readAheadBlocks;
+  fwrite(&header, sizeof(header), 1, file);
+  numRecords = 0;
+}
+
+AccessTrace::~AccessTrace() {
+  if (file == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(lock);
+  writeRecords();
+  fclose(file);
+  file = nullptr;
+}
+
+/*
+Used to record an access to a block of the buffer (called by the buffer on
+every lookup; does nothing unless the accesses are traced).
+*/
+void AccessTrace::record(int blockNum, int blockType, bool hit) {
+  if (file == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(lock);
+  records[numRecords++] = TRACE_RECORD(blockNum, blockType, hit);
+  if (numRecords == TRACE_BATCH) {
+    writeRecords();
+  }
+}
+
+// (the lock must be held)
+void AccessTrace::writeRecords() {
+  fwrite(records, sizeof(uint32_t), numRecords, file);
+  numRecords = 0;
+}
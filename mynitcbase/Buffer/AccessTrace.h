@@ -0,0 +1,57 @@
+#ifndef NITCBASE_ACCESSTRACE_H
+#define NITCBASE_ACCESSTRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+#include "../define/constants.h"
+
+/*
+ * Format of a trace file: a TraceHeader followed by one 32 bit record (in the
+ * byte order of the machine) per access to a block of the buffer, in the order
+ * of the accesses. A record packs the block number, the type of the block and
+ * whether the block was found in the buffer (see TRACE_RECORD()).
+ */
+#define TRACE_MAGIC "NITCTRC1"
+#define TRACE_RECORD(blockNum, blockType, hit) (((uint32_t)(blockNum) << 4) | ((uint32_t)(blockType) << 1) | ((hit) ? 1 : 0))
+#define TRACE_BLOCK_NUM(record) ((int)((record) >> 4))
+#define TRACE_BLOCK_TYPE(record) ((int)(((record) >> 1) & 7))
+#define TRACE_HIT(record) (((record) & 1) != 0)
+
+// the session the trace was recorded in
+struct TraceHeader {
+  char magic[8];                // TRACE_MAGIC (without the terminating '\0')
+  int32_t bufferCapacity;       // Config::bufferCapacity
+  int32_t replacementPolicy;    // Config::replacementPolicy
+  int32_t readAheadBlocks;      // Config::readAheadBlocks
+  int32_t reserved;
+};
+
+/*
+ * Recorder of the accesses to the blocks of the buffer (see --trace), for the
+ * cachesim tool to replay against other replacement policies and capacities.
+ * Every lookup of a block through the buffer is recorded (a hit, or a miss
+ * reading the block), including optimistic reads; blocks read ahead are only
+ * recorded when they are used. Records are gathered in memory and appended to
+ * the file TRACE_BATCH at a time.
+ */
+class AccessTrace {
+ private:
+  // fields
+  static FILE *file;  // nullptr if the accesses are not traced
+  static std::mutex lock;
+  static uint32_t records[TRACE_BATCH];
+  static int numRecords;
+
+  // methods
+  static void writeRecords();
+
+ public:
+  // methods
+  static void record(int blockNum, int blockType, bool hit);
+  AccessTrace();
+  ~AccessTrace();
+};
+
+#endif  // NITCBASE_ACCESSTRACE_H
@@ -0,0 +1,137 @@
+#include "BlockAllocator.h"
+
+// the declarations for this class can be found at "BlockAllocator.h"
+
+#define NUM_WORDS (DISK_BLOCKS / 64)
+
+uint64_t BlockAllocator::freeBits[NUM_WORDS];
+int BlockAllocator::numFree = 0;
+int BlockAllocator::cursor = 0;
+
+/*
+Used to set up the bitmap from the block allocation map read from the disk.
+*/
+void BlockAllocator::init(unsigned char blockAllocMap[DISK_BLOCKS]) {
+  numFree = 0;
+  cursor = 0;
+  for (int word = 0; word < NUM_WORDS; word++) {
+    freeBits[word] = 0;
+  }
+  for (int blockNum = 0; blockNum < DISK_BLOCKS; blockNum++) {
+    if (blockAllocMap[blockNum] == UNUSED_BLK) {
+      freeBits[blockNum / 64] |= (uint64_t)1 << (blockNum % 64);
+      numFree++;
+    }
+  }
+}
+
+/*
+Returns the first free block from the cursor on (wrapping around the disk), or
+E_DISKFULL. The block is not marked used.
+*/
+int BlockAllocator::findFree() {
+  if (numFree == 0) {
+    return E_DISKFULL;
+  }
+  for (int i = 0; i < NUM_WORDS; i++) {
+    int word = (cursor + i) % NUM_WORDS;
+    if (freeBits[word] != 0) {
+      cursor = word;
+      return word * 64 + __builtin_ctzll(freeBits[word]);
+    }
+  }
+  return E_DISKFULL;
+}
+
+/*
+Used to allocate a block: returns the block number (now marked used), or
+E_DISKFULL if every block is in use.
+*/
+int BlockAllocator::allocate() {
+  int blockNum = findFree();
+  if (blockNum >= 0) {
+    setUsed(blockNum);
+  }
+  return blockNum;
+}
+
+/*
+Used to allocate `count` blocks at once, into blockNums (in the order found,
+which gives consecutive blocks wherever the disk has a run of them free).
+Either all the blocks are allocated and SUCCESS returned, or none of them and
+E_DISKFULL.
+*/
+int BlockAllocator::allocate(int count, int blockNums[]) {
+  if (count > numFree) {
+    return E_DISKFULL;
+  }
+  for (int i = 0; i < count; i++) {
+    blockNums[i] = allocate();
+  }
+  return SUCCESS;
+}
+
+/*
+Used to allocate a run of consecutive blocks: the first run of `count` free
+blocks from the cursor on (wrapping around the disk, though a run does not), or
+the longest run found if there is none that long. Returns the number of blocks
+allocated, from *firstBlock on, or E_DISKFULL if every block is in use.
+*/
+int BlockAllocator::reserveRun(int count, int *firstBlock) {
+  if (numFree == 0) {
+    return E_DISKFULL;
+  }
+
+  int bestStart = -1;
+  int bestLength = 0;
+  int runStart = -1;
+  int runLength = 0;
+  for (int i = 0; i < DISK_BLOCKS && bestLength < count; i++) {
+    int blockNum = (cursor * 64 + i) % DISK_BLOCKS;
+    if (blockNum == 0) {
+      runLength = 0;
+    }
+    // (words with no free block are skipped whole)
+    if (blockNum % 64 == 0 && freeBits[blockNum / 64] == 0) {
+      runLength = 0;
+      i += 63;
+      continue;
+    }
+
+    if ((freeBits[blockNum / 64] & ((uint64_t)1 << (blockNum % 64))) == 0) {
+      runLength = 0;
+      continue;
+    }
+    if (runLength == 0) {
+      runStart = blockNum;
+    }
+    runLength++;
+    if (runLength > bestLength) {
+      bestStart = runStart;
+      bestLength = runLength;
+    }
+  }
+
+  for (int blockNum = bestStart; blockNum < bestStart + bestLength; blockNum++) {
+    setUsed(blockNum);
+  }
+  cursor = (bestStart + bestLength - 1) / 64;
+  *firstBlock = bestStart;
+  return bestLength;
+}
+
+void BlockAllocator::setUsed(int blockNum) {
+  uint64_t bit = (uint64_t)1 << (blockNum % 64);
+  if ((freeBits[blockNum / 64] & bit) != 0) {
+    freeBits[blockNum / 64] &= ~bit;
+    numFree--;
+  }
+}
+
+void BlockAllocator::setFree(int blockNum) {
+  uint64_t bit = (uint64_t)1 << (blockNum % 64);
+  if ((freeBits[blockNum / 64] & bit) == 0) {
+    freeBits[blockNum / 64] |= bit;
+    numFree++;
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef NITCBASE_BLOCKALLOCATOR_H
+#define NITCBASE_BLOCKALLOCATOR_H
+
+#include <cstdint>
+
+#include "../define/constants.h"
+
+/*
+ * Finds free blocks of the disk for StaticBuffer without scanning the block
+ * allocation map. The free blocks are kept in a bitmap (a set bit is a free
+ * block), searched a 64 bit word at a time; the search starts at a cursor
+ * left after the last block allocated and wraps around the disk (next fit), so
+ * that blocks allocated one after the other are found next to each other and
+ * the used blocks at the start of the disk are not searched again and again.
+ * The bitmap only mirrors the block allocation map: StaticBuffer tells the
+ * allocator of every change of a block between unused and used, with
+ * allocMapLock held (which guards the allocator as well).
+ */
+class BlockAllocator {
+ private:
+  // fields
+  static uint64_t freeBits[DISK_BLOCKS / 64];
+  static int numFree;
+  // index of the word of freeBits the next search starts at
+  static int cursor;
+
+  // methods
+  static int findFree();
+
+ public:
+  // methods
+  static void init(unsigned char blockAllocMap[DISK_BLOCKS]);
+  static int allocate();
+  static int allocate(int count, int blockNums[]);
+  static int reserveRun(int count, int *firstBlock);
+  static void setUsed(int blockNum);
+  static void setFree(int blockNum);
+};
+
+#endif  // NITCBASE_BLOCKALLOCATOR_H
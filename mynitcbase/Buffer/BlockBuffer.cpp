@@ -1,4 +1,6 @@
 #include "BlockBuffer.h"
+#include "AccessTrace.h"
+#include "Predicate.h"
 #include "StaticBuffer.h"
 
 #include <cstring>
@@ -8,64 +10,90 @@
 BlockBuffer::BlockBuffer(int blockNum) {
   // initialise this.blockNum with the argument
   this->blockNum = blockNum;
+  this->pinnedBufferNum = -1;
+  this->pinDepth = 0;
+  this->readBufferNum = -1;
 }
 
 // calls the parent class constructor
 RecBuffer::RecBuffer(int blockNum) : BlockBuffer::BlockBuffer(blockNum) {}
 
+// get the header of the block, as decoded by the buffer (the block is pinned,
+// and the caller holds the buffer's latch); an optimistic read gives the
+// header it began with, so that the sizes taken from it stay the same for the
+// whole read
+const struct HeadInfo *BlockBuffer::readHeader() {
+  if (this->readBufferNum != -1) {
+    return &this->readHead;
+  }
+  return &StaticBuffer::metainfo[this->pinnedBufferNum].head;
+}
+
+// get the buffer the block is read in through an OptimisticRead, for the view
+// accessors (nullptr outside of one)
+unsigned char *BlockBuffer::getViewPtr() {
+  if (this->readBufferNum != -1) {
+    return this->readPtr;
+  }
+  if (!this->heldLatch.owns_lock()) {
+    return nullptr;
+  }
+  return StaticBuffer::metainfo[this->pinnedBufferNum].data;
+}
+
 // load the block header into the argument pointer
 int BlockBuffer::getHeader(struct HeadInfo *head) {
+  // keep the block pinned while its header is read
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
 
-  unsigned char *bufferPtr;
+  std::shared_lock<std::shared_mutex> latch = readLatch();
+  *head = *readHeader();
 
-  int ret = loadBlockAndGetBufferPtr(&bufferPtr);
+  return SUCCESS;
+}
 
-  if (ret != SUCCESS) {
-    return ret;
+/* Used to get the header of the block without copying it (see BlockView):
+   *head points to the header until the OptimisticRead on this object goes
+   out of scope. Returns E_NOTPERMITTED outside of one.
+*/
+int BlockBuffer::getHeaderView(const struct HeadInfo **head) {
+  if (getViewPtr() == nullptr) {
+    return E_NOTPERMITTED;
   }
-
-  // populate the numEntries, numAttrs and numSlots fields in *head
-  memcpy(&head->blockType, bufferPtr, 4);
-  memcpy(&head->pblock, bufferPtr + 4, 4);
-  memcpy(&head->lblock, bufferPtr + 8, 4);
-  memcpy(&head->rblock, bufferPtr + 12, 4);
-  memcpy(&head->numEntries, bufferPtr + 16, 4);
-  memcpy(&head->numAttrs, bufferPtr + 20, 4);
-  memcpy(&head->numSlots, bufferPtr + 24, 4);
-  memcpy(&head->reserved, bufferPtr + 28, 4);
-
+  *head = readHeader();
   return SUCCESS;
 }
 
 // load the record at slotNum into the argument pointer
 int RecBuffer::getRecord(union Attribute *rec, int slotNum) {
-  struct HeadInfo head;
-
-  // get the header using this.getHeader() function
-  int ret = this->getHeader(&head);
-
-  if (ret != SUCCESS) {
-    return ret;
+  // keep the block pinned, so that the header and the record are read from
+  // the same buffer with a single lookup (and under a single latch)
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
   }
 
-  int attrCount = head.numAttrs;
-  int slotCount = head.numSlots;
-
   // read the block at this.blockNum into a buffer
-  unsigned char *bufferPtr;
-  ret = loadBlockAndGetBufferPtr(&bufferPtr);
-  if (ret != SUCCESS) {
-    return ret;
-  }
+  unsigned char *bufferPtr = pin.getBufferPtr();
+  std::shared_lock<std::shared_mutex> latch = readLatch();
+
+  // get the header of the block
+  const struct HeadInfo *head = readHeader();
+
+  int attrCount = head->numAttrs;
 
   /* record at slotNum will be at offset HEADER_SIZE + slotMapSize + (recordSize
      * slotNum)
      - each record will have size attrCount * ATTR_SIZE
-     - slotMap will be of size slotCount
+     - slotMap will be of a byte per slot, or of a bit per slot (see
+       getSlotMapSize())
   */
   int recordSize = attrCount * ATTR_SIZE;
   unsigned char *slotPointer =
-      bufferPtr + HEADER_SIZE + slotCount + (recordSize * slotNum);
+      bufferPtr + HEADER_SIZE + getSlotMapSize(head) + (recordSize * slotNum);
 
   // load the record into the rec data structure
   memcpy(rec, slotPointer, recordSize);
@@ -73,6 +101,27 @@ int RecBuffer::getRecord(union Attribute *rec, int slotNum) {
   return SUCCESS;
 }
 
+/* Used to get the record at slotNum without copying it (see BlockView),
+   inside an OptimisticRead on this object (else E_NOTPERMITTED is returned).
+   The attribute at index i of the record is viewAttr(rec, i * ATTR_SIZE).
+*/
+int RecBuffer::getRecordView(struct BlockView *rec, int slotNum) {
+  unsigned char *bufferPtr = getViewPtr();
+  if (bufferPtr == nullptr) {
+    return E_NOTPERMITTED;
+  }
+
+  const struct HeadInfo *head = readHeader();
+  if (slotNum < 0 || slotNum >= head->numSlots) {
+    return E_OUTOFBOUND;
+  }
+
+  int recordSize = head->numAttrs * ATTR_SIZE;
+  rec->data = bufferPtr + HEADER_SIZE + getSlotMapSize(head) + (recordSize * slotNum);
+  rec->length = recordSize;
+  return SUCCESS;
+}
+
 /* NOTE: This function will NOT check if the block has been initialised as a
    record or an index block. It will copy whatever content is there in that
    disk block to the buffer.
@@ -82,106 +131,482 @@ int RecBuffer::getRecord(union Attribute *rec, int slotNum) {
    buffer due to LRU buffer replacement. So, it will need to be bought back
    to the buffer before any operations can be done.
  */
+/* Used to get the buffer holding the block, loading the block into the buffer
+   if it is not there. Returns the buffer number, or an error code (negative).
+   The buffer returned is pinned for the caller (see BlockPin), unless the
+   block is already pinned through this object.
+*/
+int BlockBuffer::loadBlock() {
+  // a pinned block stays in the buffer it was pinned in
+  if (this->pinnedBufferNum != -1) {
+    return this->pinnedBufferNum;
+  }
+
+  // (see StaticBuffer::pinBlock())
+  return StaticBuffer::pinBlock(this->blockNum);
+}
+
+/* Used to get the address of the buffer holding the block. The address stays
+   valid while the block is pinned (see BlockPin), as it is by every accessor
+   below; otherwise it is only good until the next access to the buffer.
+*/
 int BlockBuffer::loadBlockAndGetBufferPtr(unsigned char **buffPtr) {
-  /* check whether the block is already present in the buffer
-     using StaticBuffer.getBufferNum() */
-  int bufferNum = StaticBuffer::getBufferNum(this->blockNum);
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
 
-  // if present (!=E_BLOCKNOTINBUFFER),
-  // set the timestamp of the corresponding buffer to 0 and increment the
-  // timestamps of all other occupied buffers in BufferMetaInfo.
-  if (bufferNum != E_BLOCKNOTINBUFFER) {
+  // store the pointer to this buffer (blocks[bufferNum]) in *buffPtr
+  // return SUCCESS;
+  *buffPtr = pin.getBufferPtr();
+  return SUCCESS;
+}
 
-    StaticBuffer::metainfo[bufferNum].timeStamp = 0;
+/* Used to get the latch of the buffer holding the block, which must be
+   pinned through this object. Take it shared to read the block (see
+   readLatch()) and exclusive to modify it (see WriteLatch), and release it
+   before calling StaticBuffer::setDirtyBit() or accessing another block
+   (StaticBuffer locks its shards before latches).
+*/
+std::shared_mutex &BlockBuffer::getLatch() {
+  return StaticBuffer::metainfo[this->pinnedBufferNum].latch;
+}
 
-    for (int i = 0; i < BUFFER_CAPACITY; i++) {
+/* Used to take the latch of the pinned buffer shared, to read the block.
+   An optimistic read takes no latch, and a pinned OptimisticRead holds it
+   already (an empty lock is returned).
+*/
+std::shared_lock<std::shared_mutex> BlockBuffer::readLatch() {
+  if (this->readBufferNum != -1 || this->heldLatch.owns_lock()) {
+    return std::shared_lock<std::shared_mutex>();
+  }
+  return std::shared_lock<std::shared_mutex>(getLatch());
+}
 
-      if (!StaticBuffer::metainfo[i].free && i != bufferNum) {
-        StaticBuffer::metainfo[i].timeStamp++;
+/* Used to pin the block through this object, unless it is pinned through it
+   already (the pins through an object are counted in pinDepth). Returns
+   SUCCESS, or the error if the block could not be loaded.
+*/
+int BlockBuffer::pin() {
+  // only the outermost pin pins the buffer
+  if (this->pinDepth == 0) {
+    int bufferNum = loadBlock();
+    if (bufferNum < 0) {
+      return bufferNum;
+    }
+    this->pinnedBufferNum = bufferNum;
+  }
+  this->pinDepth++;
+  return SUCCESS;
+}
+
+void BlockBuffer::unpin() {
+  this->pinDepth--;
+  if (this->pinDepth == 0) {
+    // (the pin is already gone if the block was released meanwhile)
+    if (this->pinnedBufferNum != -1) {
+      StaticBuffer::unpinBuffer(this->pinnedBufferNum);
+    }
+    this->pinnedBufferNum = -1;
+  }
+}
+
+// (while the block is read optimistically, the guard pins nothing and gives
+// the buffer being read)
+BlockPin::BlockPin(BlockBuffer &block) {
+  this->block = &block;
+  this->status = SUCCESS;
+  if (block.readBufferNum != -1) {
+    return;
+  }
+
+  this->status = block.pin();
+  if (this->status != SUCCESS) {
+    this->block = nullptr;
+  }
+}
+
+BlockPin::~BlockPin() {
+  release();
+}
+
+void BlockPin::release() {
+  if (this->block == nullptr) {
+    return;
+  }
+  if (this->block->readBufferNum == -1) {
+    this->block->unpin();
+  }
+  this->block = nullptr;
+}
+
+int BlockPin::getStatus() {
+  return this->status;
+}
+
+unsigned char *BlockPin::getBufferPtr() {
+  if (this->block == nullptr) {
+    return nullptr;
+  }
+  if (this->block->readBufferNum != -1) {
+    return this->block->readPtr;
+  }
+  if (this->block->pinnedBufferNum == -1) {
+    return nullptr;
+  }
+  return StaticBuffer::metainfo[this->block->pinnedBufferNum].data;
+}
+
+OptimisticRead::OptimisticRead(BlockBuffer &block, int attempt) {
+  this->block = &block;
+  this->optimistic = false;
+  this->latched = false;
+  this->status = SUCCESS;
+
+  // look the block up without any lock, and take its header (which must be
+  // consistent, since the rest of the read goes by its sizes)
+  // (a block pinned through the object is read under its latch anyway)
+  if (attempt < MAX_READ_RETRIES && block.pinDepth == 0 && block.readBufferNum == -1) {
+    unsigned int version;
+    int bufferNum = StaticBuffer::findBuffer(block.blockNum, &version);
+    if (bufferNum >= 0) {
+      unsigned char *bufferPtr = Disk::getBlockPtr(block.blockNum);
+      if (bufferPtr == nullptr) {
+        bufferPtr = StaticBuffer::blocks[bufferNum];
+      }
+      block.readHead = StaticBuffer::metainfo[bufferNum].head;
+      if (StaticBuffer::validateVersion(bufferNum, version)) {
+        block.readBufferNum = bufferNum;
+        block.readPtr = bufferPtr;
+        block.readVersion = version;
+        this->optimistic = true;
+        StaticBuffer::countOptimisticHit(block.readHead.blockType);
+        AccessTrace::record(block.blockNum, block.readHead.blockType, true);
+        return;
       }
     }
+  }
+
+  // else read the block pinned (see BlockPin), under its latch
+  // (a block read through the object already is read under its latch anyway)
+  this->status = block.pin();
+  if (this->status != SUCCESS) {
+    this->block = nullptr;
+    return;
+  }
+  if (block.readBufferNum == -1 && !block.heldLatch.owns_lock()) {
+    block.heldLatch = std::shared_lock<std::shared_mutex>(block.getLatch());
+    this->latched = true;
+  }
+}
+
+OptimisticRead::~OptimisticRead() {
+  if (this->block == nullptr) {
+    return;
+  }
+  if (this->optimistic) {
+    this->block->readBufferNum = -1;
   } else {
+    if (this->latched) {
+      this->block->heldLatch.unlock();
+    }
+    this->block->unpin();
+  }
+}
 
-    // else
-    // get a free buffer using StaticBuffer.getFreeBuffer()
+int OptimisticRead::getStatus() {
+  return this->status;
+}
 
-    // if the call returns E_OUTOFBOUND, return E_OUTOFBOUND here as
-    // the blockNum is invalid
+/* Used to check that the block did not change since the read began, ie. that
+   everything read through the guard is consistent. (A pinned read is.)
+*/
+bool OptimisticRead::validate() {
+  if (!this->optimistic) {
+    return true;
+  }
+  return StaticBuffer::validateVersion(this->block->readBufferNum, this->block->readVersion);
+}
 
-    // Read the block into the free buffer using readBlock()
+/* Used to get the buffer being read, and its version as the read began in
+   *version, so that it can be told later whether the block was changed since
+   (see isUnchanged()). Returns -1 if the block could not be read.
+*/
+int OptimisticRead::getBufferNum(unsigned int *version) {
+  if (this->block == nullptr) {
+    return -1;
+  }
+  if (this->optimistic) {
+    *version = this->block->readVersion;
+    return this->block->readBufferNum;
+  }
+  // (the version stays the same while the latch is held)
+  int bufferNum = this->block->pinnedBufferNum;
+  *version = StaticBuffer::metainfo[bufferNum].version.load(std::memory_order_acquire);
+  return bufferNum;
+}
 
-    bufferNum = StaticBuffer::getFreeBuffer(this->blockNum);
+/* Used to check whether a buffer is unchanged since a read of it (see
+   getBufferNum()): it still holds the same block, and the block was not
+   modified.
+*/
+bool OptimisticRead::isUnchanged(int bufferNum, unsigned int version) {
+  if (bufferNum < 0) {
+    return false;
+  }
+  return StaticBuffer::validateVersion(bufferNum, version);
+}
+
+WriteLatch::WriteLatch(BlockBuffer &block) : latch(block.getLatch()) {
+  this->bufferNum = block.pinnedBufferNum;
+  StaticBuffer::beginChange(this->bufferNum);
+}
+
+WriteLatch::~WriteLatch() {
+  StaticBuffer::endChange(this->bufferNum);
+}
+
+/*
+The slot map of a record block is either a byte per slot (SLOT_OCCUPIED or
+SLOT_UNOCCUPIED), as on the disks formatted by XFS, or, if the reserved bytes
+of the header hold SLOTMAP_BITMAP_TAG, a bitmap: bit (slot % 8) of byte
+slot / 8 is set if the slot is occupied. A bitmap is a whole number of 64 bit
+words (see viewSlotWord()), so that it is searched a word at a time; the
+records follow the slot map in either case.
+*/
+bool RecBuffer::hasBitmapSlotMap(const struct HeadInfo *head) {
+  return memcmp(head->reserved, SLOTMAP_BITMAP_TAG, sizeof(head->reserved)) == 0;
+}
+
+// size of the slot map of a record block, in bytes
+int RecBuffer::getSlotMapSize(const struct HeadInfo *head) {
+  if (hasBitmapSlotMap(head)) {
+    return (head->numSlots + 63) / 64 * 8;
+  }
+  return head->numSlots;
+}
+
+/*
+Returns the number of slots of a record block of a relation with numAttrs
+attributes: as many records, and their slot map, as fit in the block after the
+header. A bitmap leaves room for more records than a byte per slot does.
+*/
+int RecBuffer::getNumSlots(int numAttrs, bool bitmap) {
+  int recordSize = numAttrs * ATTR_SIZE;
+  int space = BLOCK_SIZE - HEADER_SIZE;
+  if (!bitmap) {
+    return space / (recordSize + 1);
+  }
 
-    if (bufferNum == E_OUTOFBOUND) {
-      return E_OUTOFBOUND;
+  // (an eighth of a byte per slot, but a whole number of words)
+  int numSlots = space * 8 / (recordSize * 8 + 1);
+  while ((numSlots + 63) / 64 * 8 + numSlots * recordSize > space) {
+    numSlots--;
+  }
+  return numSlots;
+}
+
+/*
+Used to set up the slot map of a new record block (whose header, numSlots
+included, is already set), in the format given, with every slot free.
+*/
+int RecBuffer::initSlotMap(bool bitmap) {
+  // keep the block pinned, so that the header and the slot map are changed in
+  // the same buffer with a single lookup
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
+
+  unsigned char *bufferPtr = pin.getBufferPtr();
+  struct HeadInfo *bufferHeader = (struct HeadInfo *)bufferPtr;
+
+  // (the reserved bytes are set either way: the buffer may hold the header of
+  // another block, and the block that of an older one)
+  {
+    WriteLatch latch(*this);
+    if (bitmap) {
+      memcpy(bufferHeader->reserved, SLOTMAP_BITMAP_TAG, sizeof(bufferHeader->reserved));
+      memset(bufferPtr + HEADER_SIZE, 0, getSlotMapSize(bufferHeader));
+    } else {
+      memset(bufferHeader->reserved, 0, sizeof(bufferHeader->reserved));
+      memset(bufferPtr + HEADER_SIZE, SLOT_UNOCCUPIED, bufferHeader->numSlots);
     }
+  }
 
-    Disk::readBlock(StaticBuffer::blocks[bufferNum], this->blockNum);
+  return StaticBuffer::setDirtyBit(this->blockNum);
+}
+
+/*
+Used to find the first free slot of the block. Returns its slot number, or
+E_NOTFOUND if every slot is occupied. A bitmap is searched a word at a time
+(for the first zero bit); a byte slot map with memchr().
+*/
+int RecBuffer::findFreeSlot() {
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
   }
 
-  // store the pointer to this buffer (blocks[bufferNum]) in *buffPtr
-  // return SUCCESS;
-  *buffPtr = StaticBuffer::blocks[bufferNum];
-  return SUCCESS;
+  unsigned char *bufferPtr = pin.getBufferPtr();
+  std::shared_lock<std::shared_mutex> latch = readLatch();
+  const struct HeadInfo *head = readHeader();
+
+  struct BlockView slotMap;
+  slotMap.data = bufferPtr + HEADER_SIZE;
+  slotMap.length = getSlotMapSize(head);
+
+  if (!hasBitmapSlotMap(head)) {
+    const void *freeSlot = memchr(slotMap.data, SLOT_UNOCCUPIED, head->numSlots);
+    if (freeSlot == nullptr) {
+      return E_NOTFOUND;
+    }
+    return (const unsigned char *)freeSlot - slotMap.data;
+  }
+
+  for (int word = 0; word * 64 < head->numSlots; word++) {
+    uint64_t freeBits = ~viewSlotWord(&slotMap, word);
+    if (freeBits != 0) {
+      // (the bits past the last slot are clear, and follow every slot)
+      int slot = word * 64 + __builtin_ctzll(freeBits);
+      return slot < head->numSlots ? slot : E_NOTFOUND;
+    }
+  }
+  return E_NOTFOUND;
+}
+
+/*
+Used to mark the slot slotNum of the block as occupied or free (state is
+SLOT_OCCUPIED or SLOT_UNOCCUPIED), in the format of its slot map.
+*/
+int RecBuffer::setSlotState(int slotNum, unsigned char state) {
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
+
+  unsigned char *bufferPtr = pin.getBufferPtr();
+
+  HeadInfo header;
+  getHeader(&header);
+  if (slotNum < 0 || slotNum >= header.numSlots) {
+    return E_OUTOFBOUND;
+  }
+
+  unsigned char *slotMap = bufferPtr + HEADER_SIZE;
+  {
+    WriteLatch latch(*this);
+    if (!hasBitmapSlotMap(&header)) {
+      slotMap[slotNum] = state;
+    } else if (state == SLOT_OCCUPIED) {
+      slotMap[slotNum / 8] |= 1 << (slotNum % 8);
+    } else {
+      slotMap[slotNum / 8] &= ~(1 << (slotNum % 8));
+    }
+  }
+
+  return StaticBuffer::setDirtyBit(this->blockNum);
 }
 
 /* used to get the slotmap from a record block
 NOTE: this function expects the caller to allocate memory for `*slotMap`
+(a byte per slot, SLOT_OCCUPIED or SLOT_UNOCCUPIED, whatever the format of the
+slot map in the block)
 */
 int RecBuffer::getSlotMap(unsigned char *slotMap) {
-  unsigned char *bufferPtr;
-
-  // get the starting address of the buffer containing the block using
-  // loadBlockAndGetBufferPtr().
-  int ret = loadBlockAndGetBufferPtr(&bufferPtr);
-  if (ret != SUCCESS) {
-    return ret;
+  // keep the block pinned, so that the header and the slot map are read from
+  // the same buffer with a single lookup (and under a single latch)
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
   }
 
-  struct HeadInfo head;
-  // get the header of the block using getHeader() function
-  ret = this->getHeader(&head);
-  if (ret != SUCCESS) {
-    return ret;
-  }
+  // get the starting address of the buffer containing the block
+  unsigned char *bufferPtr = pin.getBufferPtr();
+  std::shared_lock<std::shared_mutex> latch = readLatch();
 
-  int slotCount = head.numSlots; /* number of slots in block from header */
+  // get the header of the block
+  const struct HeadInfo *head = readHeader();
+
+  int slotCount = head->numSlots; /* number of slots in block from header */
 
   // get a pointer to the beginning of the slotmap in memory by offsetting
   // HEADER_SIZE
   unsigned char *slotMapInBuffer = bufferPtr + HEADER_SIZE;
 
   // copy the values from `slotMapInBuffer` to `slotMap` (size is `slotCount`)
-  memcpy(slotMap, slotMapInBuffer, slotCount);
+  // (a bitmap is unpacked into a byte per slot)
+  if (!hasBitmapSlotMap(head)) {
+    memcpy(slotMap, slotMapInBuffer, slotCount);
+  } else {
+    for (int slot = 0; slot < slotCount; slot++) {
+      bool occupied = (slotMapInBuffer[slot / 8] >> (slot % 8)) & 1;
+      slotMap[slot] = occupied ? SLOT_OCCUPIED : SLOT_UNOCCUPIED;
+    }
+  }
 
   return SUCCESS;
 }
 
-int compareAttrs(union Attribute attr1, union Attribute attr2, int attrType) {
-
-  double diff;
-  if (attrType == STRING) {
-    diff = strcmp(attr1.sVal, attr2.sVal);
-  } else {
-    diff = attr1.nVal - attr2.nVal;
+/* Used to get the slot map of the block without copying it (see BlockView),
+   inside an OptimisticRead on this object (else E_NOTPERMITTED is returned).
+*/
+int RecBuffer::getSlotMapView(struct BlockView *slotMap) {
+  unsigned char *bufferPtr = getViewPtr();
+  if (bufferPtr == nullptr) {
+    return E_NOTPERMITTED;
   }
 
+  slotMap->data = bufferPtr + HEADER_SIZE;
+  slotMap->length = getSlotMapSize(readHeader());
+  return SUCCESS;
+}
+
+// read the attribute at byte `offset` of a view
+union Attribute viewAttr(struct BlockView *view, int offset) {
+  union Attribute attr;
+  memcpy(&attr, view->data + offset, ATTR_SIZE);
+  return attr;
+}
+
+// read the 4 byte integer at byte `offset` of a view
+int32_t viewInt(struct BlockView *view, int offset) {
+  int32_t value;
+  memcpy(&value, view->data + offset, sizeof(int32_t));
+  return value;
+}
+
+// read the 64 bit word `word` of a bitmap slot map (bit i of the word is set
+// if slot word * 64 + i is occupied, see RecBuffer::hasBitmapSlotMap())
+uint64_t viewSlotWord(struct BlockView *slotMap, int word) {
+  uint64_t value;
+  memcpy(&value, slotMap->data + word * 8, sizeof(uint64_t));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  value = __builtin_bswap64(value);
+#endif
+  return value;
+}
+
+int compareAttrs(union Attribute attr1, union Attribute attr2, int attrType) {
   /*
-  if diff > 0 then return 1
-  if diff < 0 then return -1
-  if diff = 0 then return 0
+  return 1 if attr1 > attr2, -1 if attr1 < attr2, and 0 if they are equal
+  (the comparisons are those of the predicates of a search, see Predicate)
   */
-
-  if (diff > 0) {
-    return 1;
-  } else if (diff < 0) {
-    return -1;
+  if (attrType == STRING) {
+    return compareStrings(attr1, attr2);
   } else {
-    return 0;
+    return compareNumbers(attr1, attr2);
   }
 }
 
 int RecBuffer::setRecord(union Attribute *rec, int slotNum) {
+  // keep the block pinned, so that the header and the record are accessed in
+  // the same buffer with a single lookup
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
+
   unsigned char *bufferPtr;
   /* get the starting address of the buffer containing the block
      using loadBlockAndGetBufferPtr(&bufferPtr). */
@@ -217,8 +642,11 @@ int RecBuffer::setRecord(union Attribute *rec, int slotNum) {
   */
   int recordSize = numAttrs * ATTR_SIZE;
   unsigned char *slotPointer =
-      bufferPtr + HEADER_SIZE + numSlots + (recordSize * slotNum);
-  memcpy(slotPointer, rec, recordSize);
+      bufferPtr + HEADER_SIZE + getSlotMapSize(&header) + (recordSize * slotNum);
+  {
+    WriteLatch latch(*this);
+    memcpy(slotPointer, rec, recordSize);
+  }
 
   // update dirty bit using setDirtyBit()
   StaticBuffer::setDirtyBit(this->blockNum);
@@ -232,35 +660,35 @@ int RecBuffer::setRecord(union Attribute *rec, int slotNum) {
 }
 
 int BlockBuffer::setHeader(struct HeadInfo *head) {
-
-  unsigned char *bufferPtr;
-  // get the starting address of the buffer containing the block using
-  // loadBlockAndGetBufferPtr(&bufferPtr).
-  int ret = loadBlockAndGetBufferPtr(&bufferPtr);
-
-  // if loadBlockAndGetBufferPtr(&bufferPtr) != SUCCESS
-  // return the value returned by the call.
-  if (ret != SUCCESS) {
-    return ret;
+  // keep the block pinned while its header is modified
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
   }
 
+  // get the starting address of the buffer containing the block
+  unsigned char *bufferPtr = pin.getBufferPtr();
+
   // cast bufferPtr to type HeadInfo*
   struct HeadInfo *bufferHeader = (struct HeadInfo *)bufferPtr;
 
   // copy the fields of the HeadInfo pointed to by head (except reserved) to
   // the header of the block (pointed to by bufferHeader)
   //(hint: bufferHeader->numSlots = head->numSlots )
-  bufferHeader->blockType = head->blockType;
-  bufferHeader->pblock = head->pblock;
-  bufferHeader->lblock = head->lblock;
-  bufferHeader->rblock = head->rblock;
-  bufferHeader->numEntries = head->numEntries;
-  bufferHeader->numAttrs = head->numAttrs;
-  bufferHeader->numSlots = head->numSlots;
+  {
+    WriteLatch latch(*this);
+    bufferHeader->blockType = head->blockType;
+    bufferHeader->pblock = head->pblock;
+    bufferHeader->lblock = head->lblock;
+    bufferHeader->rblock = head->rblock;
+    bufferHeader->numEntries = head->numEntries;
+    bufferHeader->numAttrs = head->numAttrs;
+    bufferHeader->numSlots = head->numSlots;
+  }
 
   // update dirty bit by calling StaticBuffer::setDirtyBit()
   // if setDirtyBit() failed, return the error code
-  ret = StaticBuffer::setDirtyBit(this->blockNum);
+  int ret = StaticBuffer::setDirtyBit(this->blockNum);
 
   if (ret != SUCCESS) {
     return ret;
@@ -270,31 +698,31 @@ int BlockBuffer::setHeader(struct HeadInfo *head) {
 }
 
 int BlockBuffer::setBlockType(int blockType) {
-
-  unsigned char *bufferPtr;
-  /* get the starting address of the buffer containing the block
-     using loadBlockAndGetBufferPtr(&bufferPtr). */
-  int ret = loadBlockAndGetBufferPtr(&bufferPtr);
-
-  // if loadBlockAndGetBufferPtr(&bufferPtr) != SUCCESS
-  // return the value returned by the call.
-  if (ret != SUCCESS) {
-    return ret;
+  // keep the block pinned while it is modified
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
   }
 
+  // get the starting address of the buffer containing the block
+  unsigned char *bufferPtr = pin.getBufferPtr();
+
   // store the input block type in the first 4 bytes of the buffer.
   // (hint: cast bufferPtr to int32_t* and then assign it)
   // *((int32_t *)bufferPtr) = blockType;
-  *((int32_t *)bufferPtr) = blockType;
+  {
+    WriteLatch latch(*this);
+    *((int32_t *)bufferPtr) = blockType;
+  }
 
   // update the StaticBuffer::blockAllocMap entry corresponding to the
   // object's block number to `blockType`.
-  StaticBuffer::blockAllocMap[this->blockNum] = blockType;
+  StaticBuffer::setStaticBlockType(this->blockNum, blockType);
 
   // update dirty bit by calling StaticBuffer::setDirtyBit()
   // if setDirtyBit() failed
   // return the returned value from the call
-  ret = StaticBuffer::setDirtyBit(this->blockNum);
+  int ret = StaticBuffer::setDirtyBit(this->blockNum);
 
   if (ret != SUCCESS) {
     return ret;
@@ -304,17 +732,17 @@ int BlockBuffer::setBlockType(int blockType) {
   return SUCCESS;
 }
 
-int BlockBuffer::getFreeBlock(int blockType) {
-
-  // iterate through the StaticBuffer::blockAllocMap and find the block number
-  // of a free block in the disk.
-  int blockNum = E_DISKFULL;
-  for (int i = 0; i < DISK_BLOCKS; i++) {
+int BlockBuffer::getFreeBlock(int blockType, struct Extent *extent) {
 
-    if (StaticBuffer::blockAllocMap[i] == UNUSED_BLK) {
-      blockNum = i;
-      break;
-    }
+  // find the block number of a free block in the disk in the
+  // StaticBuffer::blockAllocMap (the block is claimed for blockType right
+  // away, so that no other thread takes it meanwhile), the next block of the
+  // extent if one is given
+  int blockNum;
+  if (extent != nullptr) {
+    blockNum = StaticBuffer::claimExtentBlock(blockType, extent);
+  } else {
+    blockNum = StaticBuffer::claimFreeBlock(blockType);
   }
 
   // if no block is free, return E_DISKFULL.
@@ -322,12 +750,20 @@ int BlockBuffer::getFreeBlock(int blockType) {
     return E_DISKFULL;
   }
 
+  return initFreeBlock(blockType, blockNum);
+}
+
+/*
+Used to set up a block just claimed for blockType (see getFreeBlock()) as a
+new, empty block of that type. Returns the block number.
+*/
+int BlockBuffer::initFreeBlock(int blockType, int blockNum) {
   // set the object's blockNum to the block number of the free block.
   this->blockNum = blockNum;
 
-  // find a free buffer using StaticBuffer::getFreeBuffer() .
-  // this may not be necessary ?
-  int buffer = StaticBuffer::getFreeBuffer(blockNum);
+  // find a free buffer for the block (its old contents on the disk need not
+  // be read)
+  StaticBuffer::loadEmptyBlock(blockNum);
 
   // initialize the header of the block passing a struct HeadInfo with values
   // pblock: -1, lblock: -1, rblock: -1, numEntries: 0, numAttrs: 0, numSlots: 0
@@ -350,25 +786,29 @@ int BlockBuffer::getFreeBlock(int blockType) {
   return blockNum;
 }
 
-BlockBuffer::BlockBuffer(char blockType) {
-  // allocate a block on the disk and a buffer in memory to hold the new block
-  // of given type using getFreeBlock function and get the return error codes if
-  // any.
+BlockBuffer::BlockBuffer(char blockType) : BlockBuffer(blockType, (struct Extent *)nullptr) {}
 
-  int type;
+// (the type of the block for the blockType character of the constructors)
+static int getBlockType(char blockType) {
   switch (blockType) {
   case 'R':
-    type = REC;
-    break;
+    return REC;
   case 'I':
-    type = IND_INTERNAL;
-    break;
-  case 'L':
-    type = IND_LEAF;
-    break;
+    return IND_INTERNAL;
+  default:
+    return IND_LEAF;
   }
+}
+
+BlockBuffer::BlockBuffer(char blockType, struct Extent *extent) {
+  // allocate a block on the disk (from the extent, if given) and a buffer in
+  // memory to hold the new block of given type using getFreeBlock function and
+  // get the return error codes if any.
+  this->pinnedBufferNum = -1;
+  this->pinDepth = 0;
+  this->readBufferNum = -1;
 
-  int ret = getFreeBlock(type);
+  int ret = getFreeBlock(getBlockType(blockType), extent);
 
   // set the blockNum field of the object to that of the allocated block
   // number if the method returned a valid block number,
@@ -379,10 +819,35 @@ BlockBuffer::BlockBuffer(char blockType) {
   // by checking the value of block number field.)
 }
 
+BlockBuffer::BlockBuffer(char blockType, struct ClaimedBlocks *claimed) {
+  // take the next of the blocks claimed already (see
+  // StaticBuffer::claimFreeBlocks()) for the new block, or E_DISKFULL if they
+  // are used up
+  this->pinnedBufferNum = -1;
+  this->pinDepth = 0;
+  this->readBufferNum = -1;
+
+  if (claimed->next == claimed->count) {
+    this->blockNum = E_DISKFULL;
+    return;
+  }
+  this->blockNum = initFreeBlock(getBlockType(blockType), claimed->blockNums[claimed->next++]);
+}
+
 // call parent non-default constructor with 'R' denoting record block.
 RecBuffer::RecBuffer() : BlockBuffer('R') {}
 
+// call parent constructor taking the next block of the extent
+RecBuffer::RecBuffer(struct Extent *extent) : BlockBuffer('R', extent) {}
+
 int RecBuffer::setSlotMap(unsigned char *slotMap) {
+  // keep the block pinned, so that the header and the slot map are accessed in
+  // the same buffer with a single lookup
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
+
   unsigned char *bufferPtr;
   /* get the starting address of the buffer containing the block using
      loadBlockAndGetBufferPtr(&bufferPtr). */
@@ -403,8 +868,21 @@ int RecBuffer::setSlotMap(unsigned char *slotMap) {
 
   // the slotmap starts at bufferPtr + HEADER_SIZE. Copy the contents of the
   // argument `slotMap` to the buffer replacing the existing slotmap.
-  // Note that size of slotmap is `numSlots`
-  memcpy(bufferPtr + HEADER_SIZE, slotMap, numSlots);
+  // Note that size of slotmap is `numSlots` (packed into bits for a bitmap)
+  {
+    WriteLatch latch(*this);
+    if (!hasBitmapSlotMap(&header)) {
+      memcpy(bufferPtr + HEADER_SIZE, slotMap, numSlots);
+    } else {
+      unsigned char *bitmap = bufferPtr + HEADER_SIZE;
+      memset(bitmap, 0, getSlotMapSize(&header));
+      for (int slot = 0; slot < numSlots; slot++) {
+        if (slotMap[slot] == SLOT_OCCUPIED) {
+          bitmap[slot / 8] |= 1 << (slot % 8);
+        }
+      }
+    }
+  }
 
   // update dirty bit using StaticBuffer::setDirtyBit
   // if setDirtyBit failed, return the value returned by the call
@@ -433,24 +911,14 @@ void BlockBuffer::releaseBlock() {
   }
 
   // else
-  /* get the buffer number of the buffer assigned to the block
-     using StaticBuffer::getBufferNum().
-     (this function return E_BLOCKNOTINBUFFER if the block is not
-     currently loaded in the buffer)
-      */
-  int bufferNum = StaticBuffer::getBufferNum(this->blockNum);
-
-  // if the block is present in the buffer, free the buffer
-  // by setting the free flag of its StaticBuffer::tableMetaInfo entry
-  // to true.
-  if (bufferNum != E_BLOCKNOTINBUFFER) {
-    StaticBuffer::metainfo[bufferNum].free = true;
-  }
+  this->pinnedBufferNum = -1;
 
-  // free the block in disk by setting the data type of the entry
-  // corresponding to the block number in StaticBuffer::blockAllocMap
-  // to UNUSED_BLK.
-  StaticBuffer::blockAllocMap[this->blockNum] = UNUSED_BLK;
+  // if the block is present in the buffer, free the buffer (which also
+  // forgets the block, so that a later allocation of the same block number
+  // does not find the stale buffer), and free the block in disk by setting
+  // the data type of the entry corresponding to the block number in
+  // StaticBuffer::blockAllocMap to UNUSED_BLK (see StaticBuffer::releaseBlock()).
+  StaticBuffer::releaseBlock(this->blockNum);
 
   // set the object's blockNum to INVALID_BLOCK (-1)
   this->blockNum = INVALID_BLOCKNUM;
@@ -459,12 +927,42 @@ void BlockBuffer::releaseBlock() {
   // being used while allocation.
 }
 
+/*
+Used to allocate `count` blocks on the disk at once, into blockNums, for the
+new blocks made from *claimed (see BlockBuffer(char, struct ClaimedBlocks *)).
+They are claimed as blockType, and each is given its own type as it is made.
+Returns E_DISKFULL, allocating none of them, if fewer than `count` blocks are
+unused.
+*/
+int BlockBuffer::claimFreeBlocks(char blockType, int count, int blockNums[],
+                                 struct ClaimedBlocks *claimed) {
+  int ret = StaticBuffer::claimFreeBlocks(getBlockType(blockType), count, blockNums);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+  claimed->blockNums = blockNums;
+  claimed->count = count;
+  claimed->next = 0;
+  return SUCCESS;
+}
+
+// used to give back the claimed blocks that were not used
+void BlockBuffer::releaseClaimedBlocks(struct ClaimedBlocks *claimed) {
+  while (claimed->next < claimed->count) {
+    StaticBuffer::releaseBlock(claimed->blockNums[claimed->next++]);
+  }
+}
+
 // call the corresponding parent constructor
 IndBuffer::IndBuffer(char blockType) : BlockBuffer(blockType) {}
 
 // call the corresponding parent constructor
 IndBuffer::IndBuffer(int blockNum) : BlockBuffer(blockNum) {}
 
+// call the corresponding parent constructor
+IndBuffer::IndBuffer(char blockType, struct ClaimedBlocks *claimed)
+    : BlockBuffer(blockType, claimed) {}
+
 // call the corresponding parent constructor
 // 'I' used to denote IndInternal.
 IndInternal::IndInternal() : IndBuffer('I') {}
@@ -472,6 +970,9 @@ IndInternal::IndInternal() : IndBuffer('I') {}
 // call the corresponding parent constructor
 IndInternal::IndInternal(int blockNum) : IndBuffer(blockNum) {}
 
+// call the parent constructor taking the next of the claimed blocks
+IndInternal::IndInternal(struct ClaimedBlocks *claimed) : IndBuffer('I', claimed) {}
+
 // this is the way to call parent non-default constructor.
 // 'L' used to denote IndLeaf.
 IndLeaf::IndLeaf() : IndBuffer('L') {}
@@ -479,6 +980,9 @@ IndLeaf::IndLeaf() : IndBuffer('L') {}
 // this is the way to call parent non-default constructor.
 IndLeaf::IndLeaf(int blockNum) : IndBuffer(blockNum) {}
 
+// call the parent constructor taking the next of the claimed blocks
+IndLeaf::IndLeaf(struct ClaimedBlocks *claimed) : IndBuffer('L', claimed) {}
+
 int IndInternal::getEntry(void *ptr, int indexNum) {
   // if the indexNum is not in the valid range of [0, MAX_KEYS_INTERNAL-1]
   //     return E_OUTOFBOUND.
@@ -486,6 +990,12 @@ int IndInternal::getEntry(void *ptr, int indexNum) {
     return E_OUTOFBOUND;
   }
 
+  // keep the block pinned while the entry is read
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
+
   unsigned char *bufferPtr;
   /* get the starting address of the buffer containing the block
      using loadBlockAndGetBufferPtr(&bufferPtr). */
@@ -513,6 +1023,7 @@ int IndInternal::getEntry(void *ptr, int indexNum) {
      from bufferPtr */
   unsigned char *entryPtr = bufferPtr + HEADER_SIZE + (indexNum * 20);
 
+  std::shared_lock<std::shared_mutex> latch = readLatch();
   memcpy(&(internalEntry->lChild), entryPtr, sizeof(int32_t));
   memcpy(&(internalEntry->attrVal), entryPtr + 4, sizeof(Attribute));
   memcpy(&(internalEntry->rChild), entryPtr + 20, 4);
@@ -529,6 +1040,12 @@ int IndLeaf::getEntry(void *ptr, int indexNum) {
     return E_OUTOFBOUND;
   }
 
+  // keep the block pinned while the entry is read
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
+
   unsigned char *bufferPtr;
   /* get the starting address of the buffer containing the block
      using loadBlockAndGetBufferPtr(&bufferPtr). */
@@ -546,12 +1063,31 @@ int IndLeaf::getEntry(void *ptr, int indexNum) {
      HEADER_SIZE + (indexNum * LEAF_ENTRY_SIZE)  from bufferPtr */
   unsigned char *entryPtr =
       bufferPtr + HEADER_SIZE + (indexNum * LEAF_ENTRY_SIZE);
+  std::shared_lock<std::shared_mutex> latch = readLatch();
   memcpy((struct Index *)ptr, entryPtr, LEAF_ENTRY_SIZE);
 
   // return SUCCESS
   return SUCCESS;
 }
 
+/* Used to get the indexNum'th entry without copying it (see BlockView), inside
+   an OptimisticRead on this object (else E_NOTPERMITTED is returned). The
+   fields are at the offsets of struct Index.
+*/
+int IndLeaf::getEntryView(struct BlockView *entry, int indexNum) {
+  if (indexNum < 0 || indexNum >= MAX_KEYS_LEAF) {
+    return E_OUTOFBOUND;
+  }
+  unsigned char *bufferPtr = getViewPtr();
+  if (bufferPtr == nullptr) {
+    return E_NOTPERMITTED;
+  }
+
+  entry->data = bufferPtr + HEADER_SIZE + (indexNum * LEAF_ENTRY_SIZE);
+  entry->length = LEAF_ENTRY_SIZE;
+  return SUCCESS;
+}
+
 int IndLeaf::setEntry(void *ptr, int indexNum) {
 
   // if the indexNum is not in the valid range of [0, MAX_KEYS_LEAF-1]
@@ -560,6 +1096,12 @@ int IndLeaf::setEntry(void *ptr, int indexNum) {
     return E_OUTOFBOUND;
   }
 
+  // keep the block pinned while the entry is modified
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
+
   unsigned char *bufferPtr;
   /* get the starting address of the buffer containing the block
      using loadBlockAndGetBufferPtr(&bufferPtr). */
@@ -577,7 +1119,10 @@ int IndLeaf::setEntry(void *ptr, int indexNum) {
      HEADER_SIZE + (indexNum * LEAF_ENTRY_SIZE)  from bufferPtr */
   unsigned char *entryPtr =
       bufferPtr + HEADER_SIZE + (indexNum * LEAF_ENTRY_SIZE);
-  memcpy(entryPtr, (struct Index *)ptr, LEAF_ENTRY_SIZE);
+  {
+    WriteLatch latch(*this);
+    memcpy(entryPtr, (struct Index *)ptr, LEAF_ENTRY_SIZE);
+  }
 
   // update dirty bit using setDirtyBit()
   // if setDirtyBit failed, return the value returned by the call
@@ -590,6 +1135,26 @@ int IndLeaf::setEntry(void *ptr, int indexNum) {
   return SUCCESS;
 }
 
+/* Used to get the indexNum'th entry without copying it (see BlockView), inside
+   an OptimisticRead on this object (else E_NOTPERMITTED is returned). The
+   entry is the lChild (at offset 0), attrVal (4) and rChild (4 + ATTR_SIZE)
+   fields of struct InternalEntry; the rChild of an entry is the lChild of the
+   next one.
+*/
+int IndInternal::getEntryView(struct BlockView *entry, int indexNum) {
+  if (indexNum < 0 || indexNum >= MAX_KEYS_INTERNAL) {
+    return E_OUTOFBOUND;
+  }
+  unsigned char *bufferPtr = getViewPtr();
+  if (bufferPtr == nullptr) {
+    return E_NOTPERMITTED;
+  }
+
+  entry->data = bufferPtr + HEADER_SIZE + (indexNum * 20);
+  entry->length = INTERNAL_ENTRY_SIZE;
+  return SUCCESS;
+}
+
 int IndInternal::setEntry(void *ptr, int indexNum) {
   // if the indexNum is not in the valid range of [0, MAX_KEYS_INTERNAL-1]
   //     return E_OUTOFBOUND.
@@ -597,6 +1162,12 @@ int IndInternal::setEntry(void *ptr, int indexNum) {
     return E_OUTOFBOUND;
   }
 
+  // keep the block pinned while the entry is modified
+  BlockPin pin(*this);
+  if (pin.getStatus() != SUCCESS) {
+    return pin.getStatus();
+  }
+
   unsigned char *bufferPtr;
   /* get the starting address of the buffer containing the block
      using loadBlockAndGetBufferPtr(&bufferPtr). */
@@ -625,9 +1196,12 @@ int IndInternal::setEntry(void *ptr, int indexNum) {
 
   unsigned char *entryPtr = bufferPtr + HEADER_SIZE + (indexNum * 20);
 
-  memcpy(entryPtr, &(internalEntry->lChild), 4);
-  memcpy(entryPtr + 4, &(internalEntry->attrVal), ATTR_SIZE);
-  memcpy(entryPtr + 20, &(internalEntry->rChild), 4);
+  {
+    WriteLatch latch(*this);
+    memcpy(entryPtr, &(internalEntry->lChild), 4);
+    memcpy(entryPtr + 4, &(internalEntry->attrVal), ATTR_SIZE);
+    memcpy(entryPtr + 20, &(internalEntry->rChild), 4);
+  }
 
   // update dirty bit using setDirtyBit()
   // if setDirtyBit failed, return the value returned by the call
@@ -2,22 +2,12 @@
 #define NITCBASE_BLOCKBUFFER_H
 
 #include <cstdint>
+#include <shared_mutex>
 
 #include "../Disk_Class/Disk.h"
 #include "../define/constants.h"
 #include "StaticBuffer.h"
 
-struct HeadInfo {
-  int32_t blockType;
-  int32_t pblock;
-  int32_t lblock;
-  int32_t rblock;
-  int32_t numEntries;
-  int32_t numAttrs;
-  int32_t numSlots;
-  unsigned char reserved[4];
-};
-
 typedef union Attribute {
   double nVal;
   char sVal[ATTR_SIZE];
@@ -38,33 +28,88 @@ struct Index {
   unsigned char unused[8];
 };
 
+// a read-only view of `length` bytes of a block in the buffer (a record, the
+// slot map or an index entry), given by the view accessors of the buffer
+// classes instead of a copy. A view is only valid inside the OptimisticRead it
+// was taken in, and an optimistic one only once validate() holds. The bytes
+// are not aligned: fields are read out of them with viewAttr() and viewInt().
+struct BlockView {
+  const unsigned char *data;
+  int length;
+};
+
+union Attribute viewAttr(struct BlockView *view, int offset);
+int32_t viewInt(struct BlockView *view, int offset);
+uint64_t viewSlotWord(struct BlockView *slotMap, int word);
+
 class BlockBuffer {
+  friend class BlockPin;
+  friend class OptimisticRead;
+  friend class WriteLatch;
+
  protected:
   // field
   int blockNum;
+  // buffer holding the block while it is pinned through this object (-1 if
+  // not pinned), and the number of BlockPin guards holding the pin
+  int pinnedBufferNum;
+  int pinDepth;
+  // buffer being read optimistically through this object (-1 if none), with
+  // its contents, its version and the block's header as the read began (see
+  // OptimisticRead)
+  int readBufferNum;
+  unsigned char *readPtr;
+  unsigned int readVersion;
+  struct HeadInfo readHead;
+  // the latch of the pinned buffer, held shared by an OptimisticRead that
+  // reads the block pinned (so that its views stay consistent)
+  std::shared_lock<std::shared_mutex> heldLatch;
   // methods
+  int pin();
+  void unpin();
+  int loadBlock();
   int loadBlockAndGetBufferPtr(unsigned char **buffPtr);
-  int getFreeBlock(int blockType);
+  std::shared_mutex &getLatch();
+  std::shared_lock<std::shared_mutex> readLatch();
+  const struct HeadInfo *readHeader();
+  unsigned char *getViewPtr();
+  int getFreeBlock(int blockType, struct Extent *extent);
+  int initFreeBlock(int blockType, int blockNum);
   int setBlockType(int blockType);
 
  public:
   // methods
   BlockBuffer(char blockType);
+  BlockBuffer(char blockType, struct Extent *extent);
+  BlockBuffer(char blockType, struct ClaimedBlocks *claimed);
   BlockBuffer(int blockNum);
   int getBlockNum();
   int getHeader(struct HeadInfo *head);
+  int getHeaderView(const struct HeadInfo **head);
   int setHeader(struct HeadInfo *head);
   void releaseBlock();
+  static int claimFreeBlocks(char blockType, int count, int blockNums[],
+                             struct ClaimedBlocks *claimed);
+  static void releaseClaimedBlocks(struct ClaimedBlocks *claimed);
 };
 
 class RecBuffer : public BlockBuffer {
  public:
   // methods
   RecBuffer();
+  RecBuffer(struct Extent *extent);
   RecBuffer(int blockNum);
+  static bool hasBitmapSlotMap(const struct HeadInfo *head);
+  static int getSlotMapSize(const struct HeadInfo *head);
+  static int getNumSlots(int numAttrs, bool bitmap);
+  int initSlotMap(bool bitmap);
+  int findFreeSlot();
+  int setSlotState(int slotNum, unsigned char state);
   int getSlotMap(unsigned char *slotMap);
+  int getSlotMapView(struct BlockView *slotMap);
   int setSlotMap(unsigned char *slotMap);
   int getRecord(union Attribute *rec, int slotNum);
+  int getRecordView(struct BlockView *rec, int slotNum);
   int setRecord(union Attribute *rec, int slotNum);
 };
 
@@ -72,6 +117,7 @@ class IndBuffer : public BlockBuffer {
  public:
   IndBuffer(int blockNum);
   IndBuffer(char blockType);
+  IndBuffer(char blockType, struct ClaimedBlocks *claimed);
   virtual int getEntry(void *ptr, int indexNum) = 0;
   virtual int setEntry(void *ptr, int indexNum) = 0;
 };
@@ -80,7 +126,9 @@ class IndInternal : public IndBuffer {
  public:
   IndInternal();
   IndInternal(int blockNum);
+  IndInternal(struct ClaimedBlocks *claimed);
   int getEntry(void *ptr, int indexNum);
+  int getEntryView(struct BlockView *entry, int indexNum);
   int setEntry(void *ptr, int indexNum);
 };
 
@@ -88,8 +136,93 @@ class IndLeaf : public IndBuffer {
  public:
   IndLeaf();
   IndLeaf(int blockNum);
+  IndLeaf(struct ClaimedBlocks *claimed);
   int getEntry(void *ptr, int indexNum);
+  int getEntryView(struct BlockView *entry, int indexNum);
   int setEntry(void *ptr, int indexNum);
 };
 
+/*
+ * Guard keeping the block of a BlockBuffer pinned in the buffer for the
+ * lifetime of the guard: the block cannot be replaced, getBufferPtr() stays
+ * valid, and the accessors of the BlockBuffer use the pinned buffer directly
+ * instead of looking the block up again on every call.
+ * release() drops the pin before the guard goes out of scope.
+ * Guards on the same object may be nested. getStatus() gives the error if the
+ * block could not be loaded (eg. E_BUFFERFULL if every buffer is pinned), in
+ * which case nothing is pinned.
+ * A pin only keeps the block in its buffer; the accessors also take the
+ * buffer's latch (see BlockBuffer::getLatch()) while they copy data in or out,
+ * so that threads sharing a block see each change whole.
+ * While the block is read optimistically (see OptimisticRead) the guard pins
+ * nothing.
+ */
+class BlockPin {
+ private:
+  BlockBuffer *block;
+  int status;
+
+ public:
+  BlockPin(BlockBuffer &block);
+  ~BlockPin();
+  BlockPin(const BlockPin &) = delete;
+  BlockPin &operator=(const BlockPin &) = delete;
+  int getStatus();
+  unsigned char *getBufferPtr();
+  void release();
+};
+
+/*
+ * Guard reading a block optimistically, for blocks that are read far more often
+ * than they are changed (eg. the internal nodes of a B+ tree, or the catalog
+ * blocks): neither a pin nor the latch is taken, so readers of the same block
+ * do not write to any shared memory. The accessors of the BlockBuffer read the
+ * buffer as it is (getHeader() gives the header as of the start of the read),
+ * and validate() then tells whether the buffer was changed meanwhile; if not,
+ * everything read through the guard is consistent, else it must be thrown
+ * away and read again with a new guard.
+ * If the block cannot be read optimistically (it is not in the buffer, or is
+ * being changed), or once MAX_READ_RETRIES attempts have failed, the guard
+ * pins the block like a BlockPin instead and holds its latch shared until it
+ * goes out of scope, and validate() always holds.
+ * The view accessors (eg. RecBuffer::getRecordView()) can only be used inside
+ * the guard, and the views they give are valid until it goes out of scope.
+ * The block must not be modified through the BlockBuffer while the guard is
+ * held, nor other blocks accessed (see BlockBuffer::getLatch()).
+ */
+class OptimisticRead {
+ private:
+  BlockBuffer *block;
+  bool optimistic;
+  bool latched;  // holds the latch of the pinned buffer (see heldLatch)
+  int status;
+
+ public:
+  OptimisticRead(BlockBuffer &block, int attempt);
+  ~OptimisticRead();
+  OptimisticRead(const OptimisticRead &) = delete;
+  OptimisticRead &operator=(const OptimisticRead &) = delete;
+  int getStatus();
+  bool validate();
+  int getBufferNum(unsigned int *version);
+  static bool isUnchanged(int bufferNum, unsigned int version);
+};
+
+/*
+ * Exclusive latch on the buffer of a block pinned through a BlockBuffer, held
+ * while the block is modified. The buffer's version is odd meanwhile, so that
+ * optimistic reads overlapping the change are retried (see OptimisticRead).
+ */
+class WriteLatch {
+ private:
+  int bufferNum;
+  std::unique_lock<std::shared_mutex> latch;
+
+ public:
+  WriteLatch(BlockBuffer &block);
+  ~WriteLatch();
+  WriteLatch(const WriteLatch &) = delete;
+  WriteLatch &operator=(const WriteLatch &) = delete;
+};
+
 #endif  // NITCBASE_BLOCKBUFFER_H
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "Flusher.h"
+
+#include <cstring>
+
+#include "../Disk_Class/Disk.h"
+
+// the declarations for this class can be found at "Flusher.h"
+
+std::thread Flusher::thread;
+std::mutex Flusher::lock;
+std::condition_variable Flusher::changed;
+bool Flusher::running = false;
+bool Flusher::stopping = false;
+bool Flusher::failed = false;
+struct FlushEntry Flusher::queue[MAX_FLUSH_BLOCKS];
+int Flusher::head = 0;
+int Flusher::count = 0;
+unsigned char Flusher::queued[DISK_BLOCKS];
+
+/*
+Used to start the thread (once, when the buffer is set up).
+*/
+void Flusher::start() {
+  if (running) {
+    return;
+  }
+  memset(queued, 0, DISK_BLOCKS);
+  head = 0;
+  count = 0;
+  failed = false;
+  stopping = false;
+  running = true;
+  thread = std::thread(run);
+}
+
+/*
+Used to stop the thread once the blocks queued are written (or could not be).
+*/
+void Flusher::stop() {
+  if (!running) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  changed.notify_all();
+  thread.join();
+  running = false;
+}
+
+bool Flusher::isRunning() {
+  return running;
+}
+
+/*
+Used to check if a copy of the block is waiting to be written.
+*/
+bool Flusher::isQueued(int blockNum) {
+  if (!running) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  return queued[blockNum] != 0;
+}
+
+/*
+Used to queue copies of blocks to be written by the thread (none of them may
+be queued already). Waits for room if the queue is full. Returns the number of
+blocks queued, which is less than numBlocks only if the thread could not write
+the blocks queued before (the rest are left to the caller).
+*/
+int Flusher::enqueue(unsigned char *blocks[], int blockNums[], int numBlocks) {
+  std::unique_lock<std::mutex> guard(lock);
+
+  int numQueued = 0;
+  for (; numQueued < numBlocks; numQueued++) {
+    if (count == MAX_FLUSH_BLOCKS) {
+      changed.notify_all();
+      changed.wait(guard, [] { return count < MAX_FLUSH_BLOCKS || failed; });
+    }
+    if (failed) {
+      break;
+    }
+
+    struct FlushEntry *entry = &queue[(head + count) % MAX_FLUSH_BLOCKS];
+    entry->blockNum = blockNums[numQueued];
+    memcpy(entry->data, blocks[numQueued], BLOCK_SIZE);
+    queued[entry->blockNum] = 1;
+    count++;
+  }
+
+  changed.notify_all();
+  return numQueued;
+}
+
+/*
+Used to wait until the copy of a block queued (if any) is written, before the
+block is read from or written to the disk again. Returns E_DISKIO if it could
+not be written.
+*/
+int Flusher::waitBlock(int blockNum) {
+  if (!running) {
+    return SUCCESS;
+  }
+
+  std::unique_lock<std::mutex> guard(lock);
+  changed.wait(guard, [blockNum] { return queued[blockNum] == 0 || failed; });
+  if (queued[blockNum] == 0) {
+    return SUCCESS;
+  }
+
+  guard.unlock();
+  return drain();
+}
+
+/*
+Used to wait until every block queued is written (before a commit).
+If the thread could not write them, they are written here once more; E_DISKIO
+is returned (and the blocks stay queued) if that fails as well.
+*/
+int Flusher::drain() {
+  if (!running) {
+    return SUCCESS;
+  }
+
+  std::unique_lock<std::mutex> guard(lock);
+  changed.wait(guard, [] { return count == 0 || failed; });
+  if (count == 0) {
+    return SUCCESS;
+  }
+
+  // the thread has given up on the blocks queued and waits while failed is set
+  int ret = writeQueued(count);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+  removeWritten(count);
+  failed = false;
+  changed.notify_all();
+  return SUCCESS;
+}
+
+/*
+Used to write the first numBlocks blocks of the queue with a single
+Disk::writeBlocks() (which writes them in block number order). The thread calls
+this without holding the lock: the entries written are not touched by
+enqueue(), which only adds entries after the first `count`.
+*/
+int Flusher::writeQueued(int numBlocks) {
+  unsigned char *blocks[numBlocks];
+  int blockNums[numBlocks];
+  for (int i = 0; i < numBlocks; i++) {
+    struct FlushEntry *entry = &queue[(head + i) % MAX_FLUSH_BLOCKS];
+    blocks[i] = entry->data;
+    blockNums[i] = entry->blockNum;
+  }
+
+  return Disk::writeBlocks(blocks, blockNums, numBlocks);
+}
+
+/*
+Used to remove the first numBlocks blocks of the queue once they are written
+(with the lock held).
+*/
+void Flusher::removeWritten(int numBlocks) {
+  for (int i = 0; i < numBlocks; i++) {
+    queued[queue[(head + i) % MAX_FLUSH_BLOCKS].blockNum] = 0;
+  }
+  head = (head + numBlocks) % MAX_FLUSH_BLOCKS;
+  count -= numBlocks;
+}
+
+/*
+The thread writes whatever is queued each time it wakes up; blocks queued
+while it is writing are written in the next round.
+*/
+void Flusher::run() {
+  std::unique_lock<std::mutex> guard(lock);
+
+  while (true) {
+    changed.wait(guard, [] { return stopping || (count > 0 && !failed); });
+    if (count == 0 || failed) {
+      // stopping
+      break;
+    }
+
+    int numBlocks = count;
+    guard.unlock();
+    int ret = writeQueued(numBlocks);
+    guard.lock();
+
+    if (ret == SUCCESS) {
+      removeWritten(numBlocks);
+    } else {
+      failed = true;
+    }
+    changed.notify_all();
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef NITCBASE_FLUSHER_H
+#define NITCBASE_FLUSHER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../define/constants.h"
+
+// a block queued for the flusher (a copy of the block taken when it was queued)
+struct FlushEntry {
+  int blockNum;
+  unsigned char data[BLOCK_SIZE];
+};
+
+/*
+ * Background writer of dirty blocks (see --flusher).
+ * The buffer queues copies of dirty blocks it is not using (see
+ * StaticBuffer::flushDirty()) and marks them clean; a thread writes the queued
+ * blocks to the disk with Disk::writeBlocks(), so that replacing them later
+ * does not have to wait for a write. A block must not be read or written by
+ * the buffer while a copy of it is queued (see waitBlock() and drain()).
+ * If a write fails the blocks stay queued, and the next waitBlock() or drain()
+ * retries them.
+ */
+class Flusher {
+ private:
+  // fields
+  static std::thread thread;
+  static std::mutex lock;
+  // signalled when blocks are queued, written or the flusher is stopped
+  static std::condition_variable changed;
+  static bool running;
+  static bool stopping;
+  // set when the thread could not write the blocks queued (they stay queued)
+  static bool failed;
+  // the blocks queued, queue[head] to queue[(head + count - 1) % MAX_FLUSH_BLOCKS]
+  static struct FlushEntry queue[MAX_FLUSH_BLOCKS];
+  static int head;
+  static int count;
+  // number of copies of each block in the queue (0 or 1)
+  static unsigned char queued[DISK_BLOCKS];
+
+  // methods
+  static void run();
+  static int writeQueued(int numBlocks);
+  static void removeWritten(int numBlocks);
+
+ public:
+  // methods
+  static void start();
+  static void stop();
+  static bool isRunning();
+  static bool isQueued(int blockNum);
+  static int enqueue(unsigned char *blocks[], int blockNums[], int numBlocks);
+  static int waitBlock(int blockNum);
+  static int drain();
+};
+
+#endif  // NITCBASE_FLUSHER_H
@@ -0,0 +1,63 @@
+#include "Predicate.h"
+
+// the declarations for this class can be found at "Predicate.h"
+
+// (a condition with an op that is not a comparison holds for no attribute)
+static bool matchesNone(const union Attribute &, const union Attribute &) {
+  return false;
+}
+
+template <int ATTR_TYPE>
+static Predicate::MatchFunction resolveMatch(int op) {
+  switch (op) {
+    case EQ:
+      return matchesTyped<ATTR_TYPE, EQ>;
+    case NE:
+      return matchesTyped<ATTR_TYPE, NE>;
+    case LT:
+      return matchesTyped<ATTR_TYPE, LT>;
+    case LE:
+      return matchesTyped<ATTR_TYPE, LE>;
+    case GT:
+      return matchesTyped<ATTR_TYPE, GT>;
+    case GE:
+      return matchesTyped<ATTR_TYPE, GE>;
+    default:
+      return matchesNone;
+  }
+}
+
+Predicate::Predicate(int attrType, int op, union Attribute value) {
+  this->attrType = attrType;
+  this->op = op;
+  this->value = value;
+
+  if (attrType == NUMBER) {
+    this->matchFunction = resolveMatch<NUMBER>(op);
+    this->compareFunction = compareTyped<NUMBER>;
+  } else {
+    this->matchFunction = resolveMatch<STRING>(op);
+    this->compareFunction = compareTyped<STRING>;
+  }
+}
+
+int Predicate::getAttrType() const {
+  return this->attrType;
+}
+
+int Predicate::getOp() const {
+  return this->op;
+}
+
+union Attribute Predicate::getValue() const {
+  return this->value;
+}
+
+/*
+Returns true if the condition holds for no attribute greater than the value
+(EQ, LT and LE): a search of attributes in ascending order can stop at the
+first one greater than the value.
+*/
+bool Predicate::isBoundedAbove() const {
+  return this->op == EQ || this->op == LT || this->op == LE;
+}
@@ -0,0 +1,145 @@
+#ifndef NITCBASE_PREDICATE_H
+#define NITCBASE_PREDICATE_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "../define/constants.h"
+#include "BlockBuffer.h"
+
+/*
+Three-way comparisons of two attributes of a type, as given by compareAttrs()
+(which is built on them): 1 if attr1 is greater, -1 if it is less, else 0.
+Numbers are compared directly; a NaN is neither greater nor less than any
+number (as their difference was).
+*/
+inline int compareNumbers(const union Attribute &attr1, const union Attribute &attr2) {
+  return (attr1.nVal > attr2.nVal) - (attr1.nVal < attr2.nVal);
+}
+
+/*
+Strings are compared in fixed width, 8 bytes at a time: the bytes of each word
+past the first NUL of attr1 are masked off in both, and the words then compared
+as big-endian numbers, which orders the strings as strcmp() does (and never
+reads past the ATTR_SIZE bytes of the attributes).
+*/
+inline int compareStrings(const union Attribute &attr1, const union Attribute &attr2) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for (int offset = 0; offset < ATTR_SIZE; offset += 8) {
+    uint64_t word1, word2;
+    memcpy(&word1, attr1.sVal + offset, 8);
+    memcpy(&word2, attr2.sVal + offset, 8);
+
+    // the NUL bytes of word1 (the lowest bit set marks the first of them)
+    uint64_t nulBytes = (word1 - 0x0101010101010101ULL) & ~word1 & 0x8080808080808080ULL;
+    if (nulBytes != 0) {
+      int length = __builtin_ctzll(nulBytes) / 8 + 1;  // up to the NUL
+      uint64_t mask = length == 8 ? ~(uint64_t)0 : ((uint64_t)1 << (length * 8)) - 1;
+      word1 &= mask;
+      word2 &= mask;
+    }
+
+    if (word1 != word2) {
+      return __builtin_bswap64(word1) > __builtin_bswap64(word2) ? 1 : -1;
+    }
+    if (nulBytes != 0) {
+      return 0;
+    }
+  }
+  return 0;
+#else
+  int diff = strncmp(attr1.sVal, attr2.sVal, ATTR_SIZE);
+  return (diff > 0) - (diff < 0);
+#endif
+}
+
+/*
+(attr op value) for numbers, without a three-way comparison; the comparisons
+agree with compareNumbers(), so that EQ, LE and GE hold for a NaN and NE, LT
+and GT do not.
+*/
+template <int OP>
+inline bool matchesNumber(double attr, double value) {
+  switch (OP) {
+    case EQ:
+      return !(attr < value) & !(attr > value);
+    case NE:
+      return (attr < value) | (attr > value);
+    case LT:
+      return attr < value;
+    case LE:
+      return !(attr > value);
+    case GT:
+      return attr > value;
+    default:  // GE
+      return !(attr < value);
+  }
+}
+
+template <int ATTR_TYPE>
+inline int compareTyped(const union Attribute &attr, const union Attribute &value) {
+  return ATTR_TYPE == NUMBER ? compareNumbers(attr, value) : compareStrings(attr, value);
+}
+
+// (attr op value) for an attribute type and an op fixed at compile time
+template <int ATTR_TYPE, int OP>
+inline bool matchesTyped(const union Attribute &attr, const union Attribute &value) {
+  if (ATTR_TYPE == NUMBER) {
+    return matchesNumber<OP>(attr.nVal, value.nVal);
+  }
+  int cmpVal = compareStrings(attr, value);
+  switch (OP) {
+    case EQ:
+      return cmpVal == 0;
+    case NE:
+      return cmpVal != 0;
+    case LT:
+      return cmpVal < 0;
+    case LE:
+      return cmpVal <= 0;
+    case GT:
+      return cmpVal > 0;
+    default:  // GE
+      return cmpVal >= 0;
+  }
+}
+
+/*
+ * A condition (attribute op value) of a search, resolved once, when the search
+ * begins, into the comparison for the type of the attribute and the op (an
+ * instance of matchesTyped() and compareTyped()), so that the records or index
+ * entries searched are tested without branching on the type or the op.
+ */
+class Predicate {
+ public:
+  typedef bool (*MatchFunction)(const union Attribute &attr, const union Attribute &value);
+  typedef int (*CompareFunction)(const union Attribute &attr, const union Attribute &value);
+
+ private:
+  // fields
+  int attrType;
+  int op;
+  union Attribute value;
+  MatchFunction matchFunction;
+  CompareFunction compareFunction;
+
+ public:
+  // methods
+  Predicate(int attrType, int op, union Attribute value);
+  int getAttrType() const;
+  int getOp() const;
+  union Attribute getValue() const;
+  bool isBoundedAbove() const;
+
+  // (attr op value)
+  bool matches(const union Attribute &attr) const {
+    return matchFunction(attr, value);
+  }
+
+  // attr compared to the value, as compareAttrs(attr, value, attrType)
+  int compare(const union Attribute &attr) const {
+    return compareFunction(attr, value);
+  }
+};
+
+#endif  // NITCBASE_PREDICATE_H
@@ -0,0 +1,260 @@
+#include "ReplacementPolicy.h"
+
+#include "../Config/Config.h"
+
+/*
+Used to create the policy selected with Config::replacementPolicy for the
+`capacity` buffers starting at firstBuffer.
+*/
+ReplacementPolicy *ReplacementPolicy::create(int policy, int firstBuffer, int capacity) {
+  if (policy == REPLACEMENT_CLOCK) {
+    return new ClockPolicy(firstBuffer, capacity);
+  }
+  if (policy == REPLACEMENT_2Q) {
+    return new TwoQPolicy(firstBuffer, capacity);
+  }
+  return new LRUPolicy(firstBuffer, capacity);
+}
+
+BufferList::BufferList(int capacity) {
+  prevs = new int[capacity];
+  nexts = new int[capacity];
+  linked = new bool[capacity];
+  for (int i = 0; i < capacity; i++) {
+    linked[i] = false;
+  }
+  head = tail = -1;
+  count = 0;
+}
+
+BufferList::~BufferList() {
+  delete[] prevs;
+  delete[] nexts;
+  delete[] linked;
+}
+
+void BufferList::pushFront(int bufferNum) {
+  prevs[bufferNum] = -1;
+  nexts[bufferNum] = head;
+  if (head != -1) {
+    prevs[head] = bufferNum;
+  } else {
+    tail = bufferNum;
+  }
+  head = bufferNum;
+  linked[bufferNum] = true;
+  count++;
+}
+
+void BufferList::remove(int bufferNum) {
+  if (!linked[bufferNum]) {
+    return;
+  }
+  if (prevs[bufferNum] != -1) {
+    nexts[prevs[bufferNum]] = nexts[bufferNum];
+  } else {
+    head = nexts[bufferNum];
+  }
+  if (nexts[bufferNum] != -1) {
+    prevs[nexts[bufferNum]] = prevs[bufferNum];
+  } else {
+    tail = prevs[bufferNum];
+  }
+  linked[bufferNum] = false;
+  count--;
+}
+
+bool BufferList::contains(int bufferNum) {
+  return linked[bufferNum];
+}
+
+int BufferList::size() {
+  return count;
+}
+
+int BufferList::front() {
+  return head;
+}
+
+int BufferList::back() {
+  return tail;
+}
+
+int BufferList::prev(int bufferNum) {
+  return prevs[bufferNum];
+}
+
+LRUPolicy::LRUPolicy(int firstBuffer, int capacity) : list(capacity) {
+  this->firstBuffer = firstBuffer;
+}
+
+void LRUPolicy::insert(int bufferNum, int /*blockNum*/) {
+  access(bufferNum);
+}
+
+void LRUPolicy::access(int bufferNum) {
+  int index = bufferNum - firstBuffer;
+  if (list.front() == index) {
+    return;
+  }
+  list.remove(index);
+  list.pushFront(index);
+}
+
+void LRUPolicy::remove(int bufferNum, int /*blockNum*/) {
+  list.remove(bufferNum - firstBuffer);
+}
+
+int LRUPolicy::getVictim(bool (*canEvict)(int bufferNum)) {
+  for (int index = list.back(); index != -1; index = list.prev(index)) {
+    if (canEvict == nullptr || canEvict(firstBuffer + index)) {
+      return firstBuffer + index;
+    }
+  }
+  return -1;
+}
+
+ClockPolicy::ClockPolicy(int firstBuffer, int capacity) {
+  this->firstBuffer = firstBuffer;
+  this->capacity = capacity;
+  present = new bool[capacity];
+  referenced = new bool[capacity];
+  for (int i = 0; i < capacity; i++) {
+    present[i] = referenced[i] = false;
+  }
+  hand = 0;
+}
+
+ClockPolicy::~ClockPolicy() {
+  delete[] present;
+  delete[] referenced;
+}
+
+void ClockPolicy::insert(int bufferNum, int /*blockNum*/) {
+  present[bufferNum - firstBuffer] = true;
+  referenced[bufferNum - firstBuffer] = true;
+}
+
+void ClockPolicy::access(int bufferNum) {
+  referenced[bufferNum - firstBuffer] = true;
+}
+
+void ClockPolicy::remove(int bufferNum, int /*blockNum*/) {
+  present[bufferNum - firstBuffer] = false;
+  referenced[bufferNum - firstBuffer] = false;
+}
+
+int ClockPolicy::getVictim(bool (*canEvict)(int bufferNum)) {
+  // two rounds are enough: the first clears every reference bit it passes
+  for (int steps = 0; steps < 2 * capacity; steps++) {
+    int index = hand;
+    hand = (hand + 1) % capacity;
+
+    if (!present[index] || (canEvict != nullptr && !canEvict(firstBuffer + index))) {
+      continue;
+    }
+    if (referenced[index]) {
+      referenced[index] = false;
+      continue;
+    }
+    return firstBuffer + index;
+  }
+  return -1;
+}
+
+/*
+The sizes suggested for 2Q: a1in holds a quarter of the buffers and a1out
+remembers as many blocks as half the buffers. a1in is made larger than a
+read-ahead window though, since blocks read ahead cannot be replaced before
+they are used and would otherwise push the victims into am; but never larger
+than half the buffers (of the shard the policy is for, see StaticBuffer), or
+am would be left no room and the victims taken from it.
+*/
+TwoQPolicy::TwoQPolicy(int firstBuffer, int capacity) : a1in(capacity), am(capacity) {
+  this->firstBuffer = firstBuffer;
+  a1inLimit = capacity / 4;
+  if (a1inLimit < Config::readAheadBlocks + 1) {
+    a1inLimit = Config::readAheadBlocks + 1;
+  }
+  if (a1inLimit > capacity / 2) {
+    a1inLimit = capacity / 2;
+  }
+  a1outLimit = capacity / 2 > 0 ? capacity / 2 : 1;
+  a1out = new int[a1outLimit];
+  for (int i = 0; i < a1outLimit; i++) {
+    a1out[i] = -1;
+  }
+  a1outNext = 0;
+  ghostPos = new int[DISK_BLOCKS];
+  for (int i = 0; i < DISK_BLOCKS; i++) {
+    ghostPos[i] = -1;
+  }
+}
+
+TwoQPolicy::~TwoQPolicy() {
+  delete[] a1out;
+  delete[] ghostPos;
+}
+
+void TwoQPolicy::insert(int bufferNum, int blockNum) {
+  int index = bufferNum - firstBuffer;
+  if (ghostPos[blockNum] != -1) {
+    // used again after leaving a1in: the block is worth keeping
+    ghostPos[blockNum] = -1;
+    am.pushFront(index);
+  } else {
+    a1in.pushFront(index);
+  }
+}
+
+void TwoQPolicy::access(int bufferNum) {
+  int index = bufferNum - firstBuffer;
+  if (am.contains(index) && am.front() != index) {
+    am.remove(index);
+    am.pushFront(index);
+  }
+}
+
+void TwoQPolicy::remove(int bufferNum, int blockNum) {
+  int index = bufferNum - firstBuffer;
+  if (am.contains(index)) {
+    am.remove(index);
+    return;
+  }
+  if (!a1in.contains(index)) {
+    return;
+  }
+  a1in.remove(index);
+
+  // remember the block in a1out, forgetting the oldest block there
+  int oldest = a1out[a1outNext];
+  if (oldest != -1 && ghostPos[oldest] == a1outNext) {
+    ghostPos[oldest] = -1;
+  }
+  a1out[a1outNext] = blockNum;
+  ghostPos[blockNum] = a1outNext;
+  a1outNext = (a1outNext + 1) % a1outLimit;
+}
+
+int TwoQPolicy::getVictimFrom(BufferList *queue, bool (*canEvict)(int bufferNum)) {
+  for (int index = queue->back(); index != -1; index = queue->prev(index)) {
+    if (canEvict == nullptr || canEvict(firstBuffer + index)) {
+      return firstBuffer + index;
+    }
+  }
+  return -1;
+}
+
+int TwoQPolicy::getVictim(bool (*canEvict)(int bufferNum)) {
+  int bufferNum = -1;
+  if (a1in.size() > a1inLimit || am.size() == 0) {
+    bufferNum = getVictimFrom(&a1in, canEvict);
+  }
+  if (bufferNum == -1) {
+    bufferNum = getVictimFrom(&am, canEvict);
+  }
+  if (bufferNum == -1) {
+    bufferNum = getVictimFrom(&a1in, canEvict);
+  }
+  return bufferNum;
+}
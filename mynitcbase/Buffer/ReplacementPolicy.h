@@ -0,0 +1,124 @@
+#ifndef NITCBASE_REPLACEMENTPOLICY_H
+#define NITCBASE_REPLACEMENTPOLICY_H
+
+/*
+ * Policy choosing the buffer to be replaced when the buffer is full.
+ * The buffer tells the policy when a block is loaded into a buffer (insert()),
+ * used again while in it (access()) and when the buffer is given back
+ * (remove()); all of these take constant time. getVictim() returns the buffer
+ * to be replaced among the occupied buffers for which canEvict() holds (every
+ * occupied buffer if canEvict is nullptr), or -1 if there is none.
+ */
+class ReplacementPolicy {
+ protected:
+  // the buffers handled are firstBuffer to firstBuffer + capacity - 1 (the
+  // buffers of one shard of the buffer); they are numbered from 0 inside
+  int firstBuffer;
+
+ public:
+  virtual ~ReplacementPolicy() {}
+  virtual void insert(int bufferNum, int blockNum) = 0;
+  virtual void access(int bufferNum) = 0;
+  virtual void remove(int bufferNum, int blockNum) = 0;
+  virtual int getVictim(bool (*canEvict)(int bufferNum)) = 0;
+
+  static ReplacementPolicy *create(int policy, int firstBuffer, int capacity);
+};
+
+/*
+ * Doubly linked list of buffer indices (the links are kept in arrays indexed
+ * by buffer number, so a buffer is in at most one position of the list).
+ * The front is the most recently added buffer.
+ */
+class BufferList {
+ private:
+  int *prevs;
+  int *nexts;
+  bool *linked;
+  int head;
+  int tail;
+  int count;
+
+ public:
+  BufferList(int capacity);
+  ~BufferList();
+  void pushFront(int bufferNum);
+  void remove(int bufferNum);
+  bool contains(int bufferNum);
+  int size();
+  int back();
+  int prev(int bufferNum);
+  int front();
+};
+
+/*
+ * Least recently used: the buffers are kept in a list in order of use, the
+ * most recently used at the front. The victim is the buffer nearest to the
+ * back that may be evicted.
+ */
+class LRUPolicy : public ReplacementPolicy {
+ private:
+  BufferList list;
+
+ public:
+  LRUPolicy(int firstBuffer, int capacity);
+  void insert(int bufferNum, int blockNum);
+  void access(int bufferNum);
+  void remove(int bufferNum, int blockNum);
+  int getVictim(bool (*canEvict)(int bufferNum));
+};
+
+/*
+ * CLOCK (second chance): a use only sets the buffer's reference bit. The hand
+ * sweeps over the buffers, clearing the reference bits it passes, and stops at
+ * the first buffer whose bit is already clear.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ private:
+  int capacity;
+  bool *present;
+  bool *referenced;
+  int hand;
+
+ public:
+  ClockPolicy(int firstBuffer, int capacity);
+  ~ClockPolicy();
+  void insert(int bufferNum, int blockNum);
+  void access(int bufferNum);
+  void remove(int bufferNum, int blockNum);
+  int getVictim(bool (*canEvict)(int bufferNum));
+};
+
+/*
+ * 2Q (Johnson and Shasha), which resists scans: a block loaded for the first
+ * time goes to the FIFO queue a1in, and only a block that is loaded again
+ * soon after it left a1in (its number is still in the ghost queue a1out)
+ * enters the LRU queue am. Uses of a block while in a1in do not promote it.
+ * Victims are taken from a1in while it holds more than its share of the
+ * buffers, so a scan only cycles through a1in and the blocks used again and
+ * again (catalog blocks, index nodes) stay in am.
+ */
+class TwoQPolicy : public ReplacementPolicy {
+ private:
+  BufferList a1in;
+  BufferList am;
+  int a1inLimit;
+  // a1out: FIFO of the numbers of the blocks last evicted from a1in
+  int *a1out;
+  int a1outLimit;
+  int a1outNext;
+  // ghostPos[blockNum] = position of the block in a1out, or -1
+  int *ghostPos;
+
+  int getVictimFrom(BufferList *queue, bool (*canEvict)(int bufferNum));
+
+ public:
+  TwoQPolicy(int firstBuffer, int capacity);
+  ~TwoQPolicy();
+  void insert(int bufferNum, int blockNum);
+  void access(int bufferNum);
+  void remove(int bufferNum, int blockNum);
+  int getVictim(bool (*canEvict)(int bufferNum));
+};
+
+#endif  // NITCBASE_REPLACEMENTPOLICY_H
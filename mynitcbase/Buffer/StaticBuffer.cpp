@@ -1,162 +1,1183 @@
 #include "StaticBuffer.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+#include "../Config/Config.h"
+#include "AccessTrace.h"
+#include "BlockAllocator.h"
+#include "Flusher.h"
+
 // the declarations for this class can be found at "StaticBuffer.h"
 
-unsigned char StaticBuffer::blocks[BUFFER_CAPACITY][BLOCK_SIZE];
-struct BufferMetaInfo StaticBuffer::metainfo[BUFFER_CAPACITY];
+/*
+Locking: a shard's lock is taken before the latch of any of its buffers, and
+chainLock before any shard's lock; a shard's lock is never taken while a latch
+is held (see BlockBuffer), and the shards are locked together only in index
+order (see commit()). The buffers of a shard that are not pinned are not being
+accessed, so they may be copied or replaced with just the shard's lock held.
+Optimistic reads (see OptimisticRead) take no lock at all: they look the block
+up in the shard's hash table and read the buffer as it is, and find out from
+the buffer's version whether it changed meanwhile. So every change to the
+contents of a buffer, or to the block it holds, is made between beginChange()
+and endChange().
+*/
+
+int StaticBuffer::capacity = 0;
+unsigned char (*StaticBuffer::blocks)[BLOCK_SIZE] = nullptr;
+size_t StaticBuffer::blocksSize = 0;
+struct BufferMetaInfo *StaticBuffer::metainfo = nullptr;
 
 // declare the blockAllocMap array
 unsigned char StaticBuffer::blockAllocMap[DISK_BLOCKS];
+unsigned char StaticBuffer::committedAllocMap[DISK_BLOCKS];
+std::mutex StaticBuffer::allocMapLock;
+struct BufferShard *StaticBuffer::shards = nullptr;
+int StaticBuffer::numShards = 0;
+std::atomic<int> StaticBuffer::numDirty(0);
+struct ChainWalk StaticBuffer::chainWalks[MAX_CHAIN_WALKS];
+int StaticBuffer::chainAccessCount = 0;
+std::mutex StaticBuffer::chainLock;
+char StaticBuffer::statsRelNames[MAX_STATS_RELATIONS][ATTR_SIZE];
+int StaticBuffer::numStatsRelations = 0;
+std::atomic<int> StaticBuffer::statsRelationOf[MAX_OPEN];
+struct BufferStats StaticBuffer::optimisticStats;
+std::mutex StaticBuffer::statsLock;
+thread_local int StaticBuffer::statsRelation = -1;
+
+// optimistic hits counted by a thread and not yet added to optimisticStats
+// (see countOptimisticHit())
+struct PendingHits {
+  unsigned long byType[BMAP + 1];
+  unsigned long byRelation[MAX_STATS_RELATIONS];
+  int count;
+};
+static thread_local struct PendingHits pendingHits;
+
+// the rblock field of the header of a block in the buffer (the latch of its
+// buffer must be held)
+static int32_t readRblock(const unsigned char *data) {
+  int32_t rblock;
+  memcpy(&rblock, data + offsetof(struct HeadInfo, rblock), sizeof(int32_t));
+  return rblock;
+}
 
 StaticBuffer::StaticBuffer() {
 
-  // copy blockAllocMap blocks from disk to buffer (using readblock() of disk)
-  // blocks 0 to 3
+  // copy blockAllocMap blocks from disk to buffer (using readBlocks() of disk,
+  // which reads the blocks 0 to 3 together)
+  unsigned char *allocMapBlocks[BLOCK_ALLOCATION_MAP_SIZE];
+  int allocMapBlockNums[BLOCK_ALLOCATION_MAP_SIZE];
   for (int i = 0; i < BLOCK_ALLOCATION_MAP_SIZE; i++) {
-    Disk::readBlock(StaticBuffer::blockAllocMap + (i * BLOCK_SIZE), i);
+    allocMapBlocks[i] = StaticBuffer::blockAllocMap + (i * BLOCK_SIZE);
+    allocMapBlockNums[i] = i;
   }
+  Disk::readBlocks(allocMapBlocks, allocMapBlockNums, BLOCK_ALLOCATION_MAP_SIZE);
+  memcpy(committedAllocMap, blockAllocMap, DISK_BLOCKS);
+  BlockAllocator::init(blockAllocMap);
 
-  // initialise all blocks as free
-  for (int bufferIndex = 0; bufferIndex < BUFFER_CAPACITY; bufferIndex++) {
-    metainfo[bufferIndex].free = true;
-    metainfo[bufferIndex].dirty = false;
-    metainfo[bufferIndex].timeStamp = -1;
-    metainfo[bufferIndex].blockNum = -1;
+  // set up the buffers (their number is chosen at startup)
+  capacity = Config::bufferCapacity;
+  allocateBlocks();
+  metainfo = new BufferMetaInfo[capacity];
+
+  // split the buffers into as many shards as they fill (upto MAX_BUFFER_SHARDS,
+  // each with at least MIN_SHARD_CAPACITY buffers)
+  numShards = 1;
+  while (numShards * 2 <= MAX_BUFFER_SHARDS && capacity / (numShards * 2) >= MIN_SHARD_CAPACITY) {
+    numShards *= 2;
+  }
+  shards = new BufferShard[numShards];
+
+  int firstBuffer = 0;
+  for (int shardIndex = 0; shardIndex < numShards; shardIndex++) {
+    BufferShard *shard = &shards[shardIndex];
+    shard->firstBuffer = firstBuffer;
+    shard->capacity = capacity / numShards + (shardIndex < capacity % numShards ? 1 : 0);
+    shard->accessCount = 0;
+    shard->stats = BufferStats();
+    firstBuffer += shard->capacity;
+
+    // initialise all blocks as free (the free buffers are handed out lowest
+    // index first)
+    shard->freeBuffers = new int[shard->capacity];
+    for (int i = 0; i < shard->capacity; i++) {
+      int bufferIndex = shard->firstBuffer + i;
+      metainfo[bufferIndex].free = true;
+      metainfo[bufferIndex].dirty = false;
+      metainfo[bufferIndex].timeStamp = 0;
+      metainfo[bufferIndex].blockNum = -1;
+      metainfo[bufferIndex].data = blocks[bufferIndex];
+      metainfo[bufferIndex].pendingRead = ASYNC_NO_REQUEST;
+      metainfo[bufferIndex].readAhead = false;
+      metainfo[bufferIndex].pinCount = 0;
+      metainfo[bufferIndex].shard = shardIndex;
+      metainfo[bufferIndex].blockType = UNUSED_BLK;
+      metainfo[bufferIndex].relation = -1;
+      metainfo[bufferIndex].version = 0;
+      metainfo[bufferIndex].referenced = false;
+      shard->freeBuffers[shard->capacity - 1 - i] = bufferIndex;
+    }
+    shard->numFreeBuffers = shard->capacity;
+    shard->policy = ReplacementPolicy::create(Config::replacementPolicy, shard->firstBuffer,
+                                              shard->capacity);
+
+    shard->hashBits = 1;
+    while ((1 << shard->hashBits) < 2 * shard->capacity) {
+      shard->hashBits++;
+    }
+    shard->hashSize = 1 << shard->hashBits;
+    shard->hash = new BufferHashEntry[shard->hashSize];
+    for (int i = 0; i < shard->hashSize; i++) {
+      shard->hash[i].blockNum = -1;
+      shard->hash[i].bufferNum = -1;
+    }
+  }
+  numDirty = 0;
+
+  for (int relId = 0; relId < MAX_OPEN; relId++) {
+    statsRelationOf[relId] = -1;
+  }
+
+  for (int i = 0; i < MAX_CHAIN_WALKS; i++) {
+    chainWalks[i].lastBlock = -1;
+    chainWalks[i].rblock = -1;
+    chainWalks[i].steps = 0;
+    chainWalks[i].ahead = 0;
+    chainWalks[i].lastUse = 0;
+  }
+
+  // with the mmap backend the buffers are the mapped blocks themselves, and
+  // a copy written in the background would overwrite later changes to them
+  if (Config::flusherDirtyRatio > 0 && Disk::getBlockPtr(0) == nullptr) {
+    Flusher::start();
   }
 }
 
 /*
-At this stage, we are not writing back from the buffer to the disk since we are
-not modifying the buffer. So, we will define an empty destructor for now. In
-subsequent stages, we will implement the write-back functionality here.
+The blocks still dirty in the buffer (and the block allocation map) are
+committed; the disk layer then checkpoints the log into the disk.
 */
 StaticBuffer::~StaticBuffer() {
+  commit();
+  Flusher::stop();
 
-  // copy blockAllocMap blocks from buffer to disk(using writeblock() of disk)
-  for (int i = 0; i < BLOCK_ALLOCATION_MAP_SIZE; i++) {
-    Disk::writeBlock(StaticBuffer::blockAllocMap + (i * BLOCK_SIZE), i);
+  for (int shardIndex = 0; shardIndex < numShards; shardIndex++) {
+    delete shards[shardIndex].policy;
+    delete[] shards[shardIndex].hash;
+    delete[] shards[shardIndex].freeBuffers;
+  }
+  delete[] shards;
+  shards = nullptr;
+  delete[] metainfo;
+  munmap(blocks, blocksSize);
+}
+
+/*
+Used to map the memory of the buffers, page aligned and in one piece.
+With --hugepages=explicit the memory is taken from the reserved huge pages
+(falling back to normal pages if there are not enough of them); with
+--hugepages=thp it is aligned to a huge page and the kernel is asked to back it
+with transparent huge pages.
+*/
+void StaticBuffer::allocateBlocks() {
+  blocksSize = (size_t)capacity * BLOCK_SIZE;
+  void *memory = MAP_FAILED;
+
+  if (Config::hugePages != HUGE_PAGES_OFF) {
+    blocksSize = (blocksSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  }
+
+  if (Config::hugePages == HUGE_PAGES_EXPLICIT) {
+    memory = mmap(nullptr, blocksSize, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+
+  if (memory == MAP_FAILED && Config::hugePages != HUGE_PAGES_OFF) {
+    // map a huge page more than needed and trim the ends so that the memory
+    // starts at a huge page boundary
+    size_t mappedSize = blocksSize + HUGE_PAGE_SIZE;
+    unsigned char *mapped = (unsigned char *)mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped != MAP_FAILED) {
+      uintptr_t start = ((uintptr_t)mapped + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+      size_t head = start - (uintptr_t)mapped;
+      if (head > 0) {
+        munmap(mapped, head);
+      }
+      munmap((unsigned char *)start + blocksSize, HUGE_PAGE_SIZE - head);
+      memory = (void *)start;
+      madvise(memory, blocksSize, MADV_HUGEPAGE);
+    }
+  }
+
+  if (memory == MAP_FAILED) {
+    blocksSize = (size_t)capacity * BLOCK_SIZE;
+    memory = mmap(nullptr, blocksSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+
+  if (memory == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  blocks = (unsigned char (*)[BLOCK_SIZE])memory;
+}
+
+/*
+Used to find the shard a block is kept in. Runs of SHARD_BLOCK_RUN consecutive
+blocks go to the same shard, so that blocks read together (see prefetch()) are
+mostly in one shard.
+*/
+BufferShard *StaticBuffer::getShard(int blockNum) {
+  return &shards[(blockNum / SHARD_BLOCK_RUN) & (numShards - 1)];
+}
+
+/*
+Used to commit every change made to the blocks so far (group commit of the
+statements executed since the last commit).
+The modified blocks of the block allocation map and the dirty buffers are
+logged using Disk::writeBlocks() and the log is committed. The buffers stay in
+the buffer, now clean.
+Every shard is locked meanwhile, so that no buffer is replaced or handed to the
+flusher while the blocks are gathered and written.
+*/
+int StaticBuffer::commit() {
+  for (int shardIndex = 0; shardIndex < numShards; shardIndex++) {
+    shards[shardIndex].lock.lock();
+  }
+
+  int ret = commitShards();
+
+  for (int shardIndex = numShards - 1; shardIndex >= 0; shardIndex--) {
+    shards[shardIndex].lock.unlock();
+  }
+  return ret;
+}
+
+// (every shard is locked by the caller, see commit())
+int StaticBuffer::commitShards() {
+  // the blocks handed to the flusher are logged before the ones written here
+  int ret = Flusher::drain();
+  if (ret != SUCCESS) {
+    return ret;
   }
 
-  /*iterate through all the buffer blocks,
-    write back blocks with metainfo as free=false,dirty=true
-    using Disk::writeBlock()
-    */
+  // gather the blocks of the block allocation map changed since the last
+  // commit and the dirty buffers, and log them with a single Disk::writeBlocks()
+  // (the dirty buffers that are pinned may be in use; they are latched so that
+  // they are not modified meanwhile)
+  std::lock_guard<std::mutex> allocMapGuard(allocMapLock);
+  unsigned char *blocksToWrite[BLOCK_ALLOCATION_MAP_SIZE + capacity];
+  int blockNums[BLOCK_ALLOCATION_MAP_SIZE + capacity];
+  int latched[capacity];
+  int count = 0;
+  int numLatched = 0;
+
+  for (int i = 0; i < BLOCK_ALLOCATION_MAP_SIZE; i++) {
+    unsigned char *block = blockAllocMap + (i * BLOCK_SIZE);
+    if (memcmp(block, committedAllocMap + (i * BLOCK_SIZE), BLOCK_SIZE) != 0) {
+      blocksToWrite[count] = block;
+      blockNums[count] = i;
+      count++;
+    }
+  }
 
-  for (int bufferIndex = 0; bufferIndex < BUFFER_CAPACITY; bufferIndex++) {
+  for (int bufferIndex = 0; bufferIndex < capacity; bufferIndex++) {
     if (!metainfo[bufferIndex].free && metainfo[bufferIndex].dirty) {
-      Disk::writeBlock(blocks[bufferIndex], metainfo[bufferIndex].blockNum);
+      metainfo[bufferIndex].latch.lock_shared();
+      latched[numLatched++] = bufferIndex;
+      blocksToWrite[count] = metainfo[bufferIndex].data;
+      blockNums[count] = metainfo[bufferIndex].blockNum;
+      count++;
     }
   }
+
+  ret = Disk::writeBlocks(blocksToWrite, blockNums, count);
+  for (int i = 0; i < numLatched; i++) {
+    metainfo[latched[i]].latch.unlock_shared();
+  }
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  memcpy(committedAllocMap, blockAllocMap, DISK_BLOCKS);
+  for (int i = 0; i < numLatched; i++) {
+    StaticBuffer::count(latched[i], &BufferCounters::committed);
+  }
+  for (int bufferIndex = 0; bufferIndex < capacity; bufferIndex++) {
+    metainfo[bufferIndex].dirty = false;
+  }
+  numDirty = 0;
+
+  return Disk::commit();
 }
 
-int StaticBuffer::getFreeBuffer(int blockNum) {
-  // Check if blockNum is valid (non zero and less than DISK_BLOCKS)
-  // and return E_OUTOFBOUND if not valid.
-  if (blockNum < 0 || blockNum > DISK_BLOCKS) {
+/*
+Used to get the buffer holding a block, pinned (see BlockPin), loading the
+block into the buffer if it is not there. Returns the buffer number, or an
+error code (negative). The shard's lock is held while the block is read, so
+that no other thread finds the buffer before it holds the block; the other
+shards are not held up.
+*/
+int StaticBuffer::pinBlock(int blockNum) {
+  if (blockNum < 0 || blockNum >= DISK_BLOCKS) {
     return E_OUTOFBOUND;
   }
 
-  // increase the timeStamp in metaInfo of all occupied buffers.
-  for (int bufferIndex = 0; bufferIndex < BUFFER_CAPACITY; bufferIndex++) {
+  BufferShard *shard = getShard(blockNum);
+  int bufferNum;
+  {
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    /* check whether the block is already present in the buffer
+       using getBufferNum() */
+    bufferNum = getBufferNum(blockNum);
+
+    // if present (!=E_BLOCKNOTINBUFFER),
+    // record the use of the buffer with the replacement policy.
+    if (bufferNum != E_BLOCKNOTINBUFFER) {
+
+      // the block may still be being read ahead (see prefetch()); if the read
+      // fails, give the buffer back as below
+      if (metainfo[bufferNum].pendingRead != ASYNC_NO_REQUEST) {
+        int ret = Disk::wait(metainfo[bufferNum].pendingRead);
+        metainfo[bufferNum].pendingRead = ASYNC_NO_REQUEST;
+        if (ret != SUCCESS) {
+          freeBuffer(bufferNum);
+          return ret;
+        }
+        endChange(bufferNum);
+      }
+
+      recordAccess(bufferNum);
+      if (statsRelation != -1) {
+        metainfo[bufferNum].relation = statsRelation;
+      }
+      count(bufferNum, &BufferCounters::hits);
+      AccessTrace::record(blockNum, metainfo[bufferNum].blockType, true);
+    } else {
+
+      // else
+      // get a free buffer using getFreeBuffer()
+      // (E_DISKIO if the victim buffer could not be written back, or
+      // E_BUFFERFULL if every buffer of the shard is pinned)
+      bufferNum = getFreeBuffer(blockNum);
+      if (bufferNum < 0) {
+        return bufferNum;
+      }
 
-    if (!metainfo[bufferIndex].free) {
-      metainfo[bufferIndex].timeStamp++;
+      // Read the block into the free buffer using readBlock()
+      // if the read fails, give the buffer back so that its stale contents
+      // are not mistaken for the block
+      // (with the mmap backend the buffer already points at the block and
+      // readBlock() does not copy anything)
+      int ret = Disk::readBlock(metainfo[bufferNum].data, blockNum);
+      if (ret != SUCCESS) {
+        freeBuffer(bufferNum);
+        return ret;
+      }
+      endChange(bufferNum);
+      count(bufferNum, &BufferCounters::misses);
+      AccessTrace::record(blockNum, metainfo[bufferNum].blockType, false);
     }
+
+    metainfo[bufferNum].readAhead = false;
+    metainfo[bufferNum].pinCount++;
   }
 
-  // let bufferNum be used to store the buffer number of the free/freed buffer.
-  int bufferNum = -1;
+  trackAccess(bufferNum);
+  return bufferNum;
+}
 
-  // iterate through metainfo and check if there is any buffer free
+/*
+Used to drop a pin taken with pinBlock(). (The shard's lock is not needed: a
+pin is only taken with the lock held, so a buffer seen unpinned under the lock
+stays unpinned until the lock is released.)
+*/
+void StaticBuffer::unpinBuffer(int bufferNum) {
+  metainfo[bufferNum].pinCount--;
+}
 
-  // if a free buffer is available, set bufferNum = index of that free buffer.
-  for (int i = 0; i < BUFFER_CAPACITY; i++) {
-    if (metainfo[i].free) {
-      bufferNum = i;
-      break;
+/*
+Used to give a block that has just been allocated a buffer, without reading
+its (unused) contents from the disk. Returns the buffer number, or an error
+code (negative).
+*/
+int StaticBuffer::loadEmptyBlock(int blockNum) {
+  if (blockNum < 0 || blockNum >= DISK_BLOCKS) {
+    return E_OUTOFBOUND;
+  }
+
+  BufferShard *shard = getShard(blockNum);
+  std::lock_guard<std::mutex> guard(shard->lock);
+  int bufferNum = getBufferNum(blockNum);
+  if (bufferNum != E_BLOCKNOTINBUFFER) {
+    return bufferNum;
+  }
+  bufferNum = getFreeBuffer(blockNum);
+  if (bufferNum >= 0) {
+    endChange(bufferNum);
+  }
+  return bufferNum;
+}
+
+/*
+Used to allocate a block on the disk: a block that is unused in the block
+allocation map (found by the BlockAllocator) is given the type blockType.
+Returns the block number, or E_DISKFULL if every block is in use.
+*/
+int StaticBuffer::claimFreeBlock(int blockType) {
+  std::lock_guard<std::mutex> guard(allocMapLock);
+  int blockNum = BlockAllocator::allocate();
+  if (blockNum >= 0) {
+    blockAllocMap[blockNum] = blockType;
+  }
+  return blockNum;
+}
+
+/*
+Used to allocate `count` blocks on the disk at once (see claimFreeBlock()),
+into blockNums. Returns E_DISKFULL, allocating none of them, if fewer than
+`count` blocks are unused.
+*/
+int StaticBuffer::claimFreeBlocks(int blockType, int count, int blockNums[]) {
+  std::lock_guard<std::mutex> guard(allocMapLock);
+  int ret = BlockAllocator::allocate(count, blockNums);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+  for (int i = 0; i < count; i++) {
+    blockAllocMap[blockNums[i]] = blockType;
+  }
+  return SUCCESS;
+}
+
+/*
+Used to allocate the next block of a relation's extent (see --extent) and give
+it the type blockType. When the extent is used up, another run of
+Config::extentBlocks consecutive blocks (or as many as there are together) is
+reserved first. The blocks reserved stay unused in the block allocation map
+until they are taken, so that the ones never taken are not lost if the
+session ends without releaseExtent(). Returns the block number, or E_DISKFULL.
+*/
+int StaticBuffer::claimExtentBlock(int blockType, struct Extent *extent) {
+  std::lock_guard<std::mutex> guard(allocMapLock);
+  if (extent->next == extent->end) {
+    int firstBlock;
+    int count = BlockAllocator::reserveRun(Config::extentBlocks, &firstBlock);
+    if (count < 0) {
+      return count;
     }
+    extent->next = firstBlock;
+    extent->end = firstBlock + count;
   }
 
-  // if a free buffer is not available,
-  //     find the buffer with the largest timestamp
-  //     IF IT IS DIRTY, write back to the disk using Disk::writeBlock()
-  //     set bufferNum = index of this buffer
-  if (bufferNum == -1) {
+  int blockNum = extent->next++;
+  blockAllocMap[blockNum] = blockType;
+  return blockNum;
+}
 
-    int largestTime = -1;
+/*
+Used to give back the blocks of an extent that were not taken (when the
+relation is closed).
+*/
+void StaticBuffer::releaseExtent(struct Extent *extent) {
+  std::lock_guard<std::mutex> guard(allocMapLock);
+  for (int blockNum = extent->next; blockNum < extent->end; blockNum++) {
+    if (blockAllocMap[blockNum] == UNUSED_BLK) {
+      BlockAllocator::setFree(blockNum);
+    }
+  }
+  extent->next = extent->end = -1;
+}
 
-    for (int i = 0; i < BUFFER_CAPACITY; i++) {
+/*
+Used to free a block on the disk: its buffer (if any) is given back, and the
+block is marked unused in the block allocation map.
+*/
+void StaticBuffer::releaseBlock(int blockNum) {
+  if (blockNum < 0 || blockNum >= DISK_BLOCKS) {
+    return;
+  }
 
-      if (metainfo[i].timeStamp > largestTime) {
-        bufferNum = i;
-        largestTime = metainfo[i].timeStamp;
-      }
+  {
+    BufferShard *shard = getShard(blockNum);
+    std::lock_guard<std::mutex> guard(shard->lock);
+    int bufferNum = getBufferNum(blockNum);
+    if (bufferNum >= 0) {
+      freeBuffer(bufferNum);
     }
+  }
+
+  std::lock_guard<std::mutex> guard(allocMapLock);
+  blockAllocMap[blockNum] = UNUSED_BLK;
+  BlockAllocator::setFree(blockNum);
+}
+
+void StaticBuffer::setStaticBlockType(int blockNum, int blockType) {
+  std::lock_guard<std::mutex> guard(allocMapLock);
+  blockAllocMap[blockNum] = blockType;
+  if (blockType == UNUSED_BLK) {
+    BlockAllocator::setFree(blockNum);
+  } else {
+    BlockAllocator::setUsed(blockNum);
+  }
+}
+
+// (the lock of the block's shard must be held)
+int StaticBuffer::getFreeBuffer(int blockNum) {
+  // Check if blockNum is valid (non zero and less than DISK_BLOCKS)
+  // and return E_OUTOFBOUND if not valid.
+  if (blockNum < 0 || blockNum >= DISK_BLOCKS) {
+    return E_OUTOFBOUND;
+  }
+  BufferShard *shard = getShard(blockNum);
 
-    if (metainfo[bufferNum].dirty) {
-      Disk::writeBlock(blocks[bufferNum], metainfo[bufferNum].blockNum);
+  // the block is about to be read; a copy of it still queued for the flusher
+  // must reach the disk first
+  int ret = Flusher::waitBlock(blockNum);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  // if a free buffer is not available,
+  //     find the buffer chosen by the replacement policy and evict it
+  //     (writing it back to the disk IF IT IS DIRTY)
+  if (shard->numFreeBuffers == 0) {
+    int victim = getVictimBuffer(shard);
+    if (victim == -1) {
+      return E_BUFFERFULL;
     }
+    ret = evictBuffer(victim);
+    if (ret != SUCCESS) {
+      return ret;
+    }
+  }
+
+  // set bufferNum = index of a free buffer.
+  int bufferNum = shard->freeBuffers[--shard->numFreeBuffers];
+
+  // a read-ahead into the buffer may still be in flight (if the block was
+  // never used, or the buffer was released); it must finish before the buffer
+  // is reused
+  if (metainfo[bufferNum].pendingRead != ASYNC_NO_REQUEST) {
+    Disk::wait(metainfo[bufferNum].pendingRead);
+    metainfo[bufferNum].pendingRead = ASYNC_NO_REQUEST;
   }
 
   // update the metaInfo entry corresponding to bufferNum with
-  // free:false, dirty:false, blockNum:the input block number, timeStamp:0.
+  // free:false, dirty:false, blockNum:the input block number, and count the
+  // loading as a use of the buffer.
+  // (the change lasts until the caller has loaded the block into the buffer)
+  beginChange(bufferNum);
   metainfo[bufferNum].free = false;
   metainfo[bufferNum].dirty = false;
   metainfo[bufferNum].blockNum = blockNum;
-  metainfo[bufferNum].timeStamp = 0;
+  metainfo[bufferNum].timeStamp = ++shard->accessCount;
+  metainfo[bufferNum].readAhead = false;
+  metainfo[bufferNum].pinCount = 0;
+  metainfo[bufferNum].referenced = false;
+  {
+    std::lock_guard<std::mutex> allocMapGuard(allocMapLock);
+    metainfo[bufferNum].blockType = blockAllocMap[blockNum];
+  }
+  metainfo[bufferNum].relation = statsRelation;
+  hashInsert(shard, blockNum, bufferNum);
+  shard->policy->insert(bufferNum, blockNum);
+
+  // with the mmap backend the buffer refers to the mapped block itself, so
+  // loading the block does not need to copy it
+  unsigned char *mapped = Disk::getBlockPtr(blockNum);
+  metainfo[bufferNum].data = (mapped != nullptr) ? mapped : blocks[bufferNum];
 
   // return the bufferNum.
   return bufferNum;
 }
 
+/*
+Used to evict the block in a buffer, freeing the buffer. A dirty block is
+written back first (the write-back is only started with the io_uring backend;
+the contents are copied, so the buffer can be reused right away). If the
+write-back fails, the block (and its changes) stays in the buffer and the error
+is returned.
+*/
+int StaticBuffer::evictBuffer(int bufferNum) {
+  if (metainfo[bufferNum].dirty) {
+    // (an older copy of the block may still be queued for the flusher)
+    int ret = Flusher::waitBlock(metainfo[bufferNum].blockNum);
+    if (ret != SUCCESS) {
+      return ret;
+    }
+    ret = Disk::writeBlockAsync(metainfo[bufferNum].data, metainfo[bufferNum].blockNum);
+    if (ret != SUCCESS) {
+      return ret;
+    }
+    count(bufferNum, &BufferCounters::writeBacks);
+  }
+
+  count(bufferNum, &BufferCounters::evictions);
+  freeBuffer(bufferNum);
+  return SUCCESS;
+}
+
+/*
+Used to choose the buffer of a shard to be replaced when none of its buffers is
+free, using the shard's replacement policy, or -1 if every buffer of the shard
+is pinned. Blocks read ahead and not used yet are passed over (unless every
+unpinned buffer holds one), so that a read-ahead is not undone before the scan
+that asked for it reaches the blocks; once such a block has gone cold (see
+isCold()) the scan is taken to have moved on without it, and the block is
+replaced like any other.
+A buffer read optimistically since it was last chosen is not replaced: its use
+is recorded with the policy now, and the policy is asked again.
+*/
+int StaticBuffer::getVictimBuffer(BufferShard *shard) {
+  int bufferNum = -1;
+  for (int round = 0; round < shard->capacity; round++) {
+    bufferNum = shard->policy->getVictim(canEvict);
+    if (bufferNum == -1) {
+      bufferNum = shard->policy->getVictim(isUnpinned);
+    }
+    if (bufferNum == -1 || !metainfo[bufferNum].referenced.exchange(false)) {
+      break;
+    }
+    recordAccess(bufferNum);
+  }
+  return bufferNum;
+}
+
+bool StaticBuffer::canEvict(int bufferNum) {
+  return metainfo[bufferNum].pinCount == 0 &&
+         (!metainfo[bufferNum].readAhead || isCold(bufferNum));
+}
+
+bool StaticBuffer::isUnpinned(int bufferNum) {
+  return metainfo[bufferNum].pinCount == 0;
+}
+
+/*
+Used to find whether a buffer has not been used in the last accesses to its
+shard (as many as the shard has buffers).
+*/
+bool StaticBuffer::isCold(int bufferNum) {
+  BufferShard *shard = &shards[metainfo[bufferNum].shard];
+  return shard->accessCount - (unsigned int)metainfo[bufferNum].timeStamp >=
+         (unsigned int)shard->capacity;
+}
+
+/*
+Used to record a use of the block in a buffer (a hit).
+*/
+void StaticBuffer::recordAccess(int bufferNum) {
+  BufferShard *shard = &shards[metainfo[bufferNum].shard];
+  metainfo[bufferNum].timeStamp = ++shard->accessCount;
+  shard->policy->access(bufferNum);
+}
+
+/*
+Used to start loading a set of blocks into the buffer ahead of their use.
+Blocks already in the buffer are skipped. With asynchronous I/O the reads are
+only started, and waited for when the block is first accessed (see
+pinBlock()); otherwise the blocks are read together with Disk::readBlocks(),
+which coalesces runs of consecutive blocks.
+Only free or cold buffers (not used in the last accesses to their shard) are
+taken, so a read-ahead never pushes out blocks in active use (nor the blocks
+of another read-ahead, until they have gone cold unused).
+The blocks of each shard are loaded with the shard's lock held, one shard at a
+time, and no more of them than half the shard's buffers (the window of
+--readahead is checked against the whole buffer only).
+*/
+int StaticBuffer::prefetch(int blockNums[], int count) {
+  int shardBlockNums[count];
+  int ret = SUCCESS;
+
+  for (int shardIndex = 0; shardIndex < numShards; shardIndex++) {
+    int shardCount = 0;
+    for (int i = 0; i < count && shardCount < shards[shardIndex].capacity / 2; i++) {
+      if (blockNums[i] >= 0 && blockNums[i] < DISK_BLOCKS &&
+          getShard(blockNums[i]) == &shards[shardIndex]) {
+        shardBlockNums[shardCount++] = blockNums[i];
+      }
+    }
+    if (shardCount == 0) {
+      continue;
+    }
+
+    int shardRet = prefetchShard(&shards[shardIndex], shardBlockNums, shardCount);
+    if (shardRet != SUCCESS) {
+      ret = shardRet;
+    }
+  }
+
+  return ret;
+}
+
+// (loads the blocks of one shard, see prefetch())
+int StaticBuffer::prefetchShard(BufferShard *shard, int blockNums[], int count) {
+  std::lock_guard<std::mutex> guard(shard->lock);
+  unsigned char *buffers[count];
+  int readBlockNums[count];
+  int bufferNums[count];
+  int numToRead = 0;
+
+  for (int i = 0; i < count; i++) {
+    int bufferNum = getBufferNum(blockNums[i]);
+    if (bufferNum != E_BLOCKNOTINBUFFER) {
+      // already in the buffer
+      continue;
+    }
+
+    if (shard->numFreeBuffers == 0) {
+      // (the victim is evicted here, since asking the policy again may give
+      // another buffer)
+      int victim = getVictimBuffer(shard);
+      if (victim == -1 || !isCold(victim) || evictBuffer(victim) != SUCCESS) {
+        break;
+      }
+    }
+
+    bufferNum = getFreeBuffer(blockNums[i]);
+    if (bufferNum < 0) {
+      break;
+    }
+    metainfo[bufferNum].readAhead = true;
+    StaticBuffer::count(bufferNum, &BufferCounters::readAheads);
+
+    if (Disk::isAsync()) {
+      int ret = Disk::readBlockAsync(metainfo[bufferNum].data, blockNums[i],
+                                     &metainfo[bufferNum].pendingRead);
+      if (ret != SUCCESS) {
+        freeBuffer(bufferNum);
+        return ret;
+      }
+      // (a block read synchronously, eg. out of the log, is loaded already)
+      if (metainfo[bufferNum].pendingRead == ASYNC_NO_REQUEST) {
+        endChange(bufferNum);
+      }
+    } else {
+      buffers[numToRead] = metainfo[bufferNum].data;
+      readBlockNums[numToRead] = blockNums[i];
+      bufferNums[numToRead] = bufferNum;
+      numToRead++;
+    }
+  }
+
+  if (numToRead == 0) {
+    return SUCCESS;
+  }
+
+  int ret = Disk::readBlocks(buffers, readBlockNums, numToRead);
+  for (int i = 0; i < numToRead; i++) {
+    if (ret == SUCCESS) {
+      endChange(bufferNums[i]);
+    } else {
+      freeBuffer(bufferNums[i]);
+    }
+  }
+  return ret;
+}
+
+/*
+Used to detect scans walking chains of blocks (record blocks of a relation, or
+leaves of a B+ tree) through the rblock links of their headers. Called on
+every access to a block (see pinBlock()), with the block pinned.
+Upto MAX_CHAIN_WALKS chains are followed at a time, since a scan is usually
+interleaved with accesses to other chains (eg. the relation a select inserts
+into). Once two consecutive steps along a chain are seen, the blocks ahead in
+the chain are read ahead.
+*/
+void StaticBuffer::trackAccess(int bufferNum) {
+  int blockNum = metainfo[bufferNum].blockNum;
+
+  // (the type in the block's header is the one in blockAllocMap, and does not
+  // need allocMapLock)
+  int32_t blockType;
+  int32_t rblock;
+  {
+    std::shared_lock<std::shared_mutex> latch(metainfo[bufferNum].latch);
+    memcpy(&blockType, metainfo[bufferNum].data + offsetof(struct HeadInfo, blockType),
+           sizeof(int32_t));
+    rblock = readRblock(metainfo[bufferNum].data);
+  }
+  if (blockType != REC && blockType != IND_LEAF) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(chainLock);
+  chainAccessCount++;
+
+  // find the walk this access continues (or repeats), else replace the walk
+  // used least recently
+  int walk = 0;
+  bool found = false;
+  for (int i = 0; i < MAX_CHAIN_WALKS && !found; i++) {
+    if (chainWalks[i].lastBlock == blockNum) {
+      chainWalks[i].lastUse = chainAccessCount;
+      return;
+    }
+    if (chainWalks[i].lastBlock != -1 && chainWalks[i].rblock == blockNum) {
+      walk = i;
+      found = true;
+    } else if (chainWalks[i].lastUse < chainWalks[walk].lastUse) {
+      walk = i;
+    }
+  }
+
+  ChainWalk *chain = &chainWalks[walk];
+  chain->steps = found ? chain->steps + 1 : 0;
+  chain->ahead = found ? chain->ahead - 1 : 0;
+  chain->lastBlock = blockNum;
+  chain->lastUse = chainAccessCount;
+  chain->rblock = rblock;
+
+  // the next window is read once the walk has used up the previous one, so
+  // that the blocks of a window are read together
+  if (chain->steps >= 1 && chain->ahead <= 0 && Config::readAheadBlocks > 0) {
+    chain->ahead = readAhead(bufferNum);
+  }
+}
+
+/*
+Used to read ahead the next Config::readAheadBlocks blocks in the chain of the
+block in the (pinned) buffer bufferNum. Returns the number of blocks in the
+window (a read-ahead that fails only costs the blocks being read on demand
+later).
+The chain is followed through the rblock links of the blocks that are in the
+buffer. Past the first block that is not (yet), only a chain of record blocks
+is assumed to go on, with the following blocks on the disk, and for no more
+than the rest of an extent (see --extent): the record blocks of a relation are
+consecutive within each of its extents, while the blocks past an extent (and
+the leaves of a B+ tree) may belong to anything.
+*/
+int StaticBuffer::readAhead(int bufferNum) {
+  int blockType = getStaticBlockType(metainfo[bufferNum].blockNum);
+  int blockNums[Config::readAheadBlocks];
+  int count = 0;
+
+  int rblock;
+  {
+    std::shared_lock<std::shared_mutex> latch(metainfo[bufferNum].latch);
+    rblock = readRblock(metainfo[bufferNum].data);
+  }
+
+  bool following = true;
+  int guesses = blockType == REC ? Config::extentBlocks - 1 : 0;
+  while (count < Config::readAheadBlocks && rblock >= 0 && rblock < DISK_BLOCKS &&
+         getStaticBlockType(rblock) == blockType) {
+    blockNums[count++] = rblock;
+
+    // (the next block's buffer cannot be replaced while its shard is locked)
+    bool inBuffer = false;
+    if (following) {
+      BufferShard *shard = getShard(rblock);
+      std::lock_guard<std::mutex> guard(shard->lock);
+      int next = getBufferNum(rblock);
+      if (next >= 0 && metainfo[next].pendingRead == ASYNC_NO_REQUEST) {
+        std::shared_lock<std::shared_mutex> latch(metainfo[next].latch);
+        rblock = readRblock(metainfo[next].data);
+        inBuffer = true;
+      }
+    }
+    if (!inBuffer) {
+      if (guesses == 0) {
+        break;
+      }
+      guesses--;
+      following = false;
+      rblock++;
+    }
+  }
+
+  prefetch(blockNums, count);
+  return count;
+}
+
 /* Get the buffer index where a particular block is stored
    or E_BLOCKNOTINBUFFER otherwise
+   (the lock of the block's shard must be held)
 */
 int StaticBuffer::getBufferNum(int blockNum) {
   // Check if blockNum is valid (between zero and DISK_BLOCKS)
   // and return E_OUTOFBOUND if not valid.
-  if (blockNum < 0 || blockNum > DISK_BLOCKS) {
+  if (blockNum < 0 || blockNum >= DISK_BLOCKS) {
     return E_OUTOFBOUND;
   }
+  BufferShard *shard = getShard(blockNum);
+
+  // find and return the bufferIndex which corresponds to blockNum (look it
+  // up in the shard's hash table, probing from the block's home slot up to an
+  // empty slot)
+  for (int slot = hashSlot(shard, blockNum);; slot = (slot + 1) & (shard->hashSize - 1)) {
+    if (shard->hash[slot].blockNum == blockNum) {
+      return shard->hash[slot].bufferNum;
+    }
+    if (shard->hash[slot].blockNum == -1) {
+      // if block is not in the buffer
+      return E_BLOCKNOTINBUFFER;
+    }
+  }
+}
+
+/*
+Used to find the buffer holding a block without the shard's lock, for an
+optimistic read (see OptimisticRead). Returns the buffer number and its version
+in *version, or E_BLOCKNOTINBUFFER if the block is not in the buffer, or is
+being loaded or changed right now, or has been read ahead and not used yet
+(its first use goes through pinBlock(), which follows the scan).
+The hash table may be changing meanwhile, so what is found is checked against
+the buffer itself; the read is then good as long as the version stays the same
+(see validateVersion()).
+*/
+int StaticBuffer::findBuffer(int blockNum, unsigned int *version) {
+  if (blockNum < 0 || blockNum >= DISK_BLOCKS) {
+    return E_OUTOFBOUND;
+  }
+  BufferShard *shard = getShard(blockNum);
+
+  int mask = shard->hashSize - 1;
+  int slot = hashSlot(shard, blockNum);
+  for (int probes = 0; probes < shard->hashSize; probes++, slot = (slot + 1) & mask) {
+    int slotBlockNum = shard->hash[slot].blockNum.load(std::memory_order_relaxed);
+    if (slotBlockNum == -1) {
+      break;
+    }
+    if (slotBlockNum != blockNum) {
+      continue;
+    }
 
-  // find and return the bufferIndex which corresponds to blockNum (check
-  // metainfo)
-  for (int bufferIndex = 0; bufferIndex < BUFFER_CAPACITY; bufferIndex++) {
+    int bufferNum = shard->hash[slot].bufferNum.load(std::memory_order_relaxed);
+    if (bufferNum < shard->firstBuffer || bufferNum >= shard->firstBuffer + shard->capacity) {
+      break;
+    }
+    struct BufferMetaInfo *info = &metainfo[bufferNum];
+    unsigned int bufferVersion = info->version.load(std::memory_order_acquire);
+    if ((bufferVersion & 1) != 0 || info->blockNum.load(std::memory_order_relaxed) != blockNum ||
+        info->readAhead.load(std::memory_order_relaxed)) {
+      break;
+    }
 
-    if (metainfo[bufferIndex].blockNum == blockNum) {
-      return bufferIndex;
+    // (the flag is only written when it is not set yet, so that readers of a
+    // hot block do not keep taking its cache line from each other)
+    if (!info->referenced.load(std::memory_order_relaxed)) {
+      info->referenced.store(true, std::memory_order_relaxed);
     }
+    *version = bufferVersion;
+    return bufferNum;
   }
 
-  // if block is not in the buffer
   return E_BLOCKNOTINBUFFER;
 }
 
-int StaticBuffer::setDirtyBit(int blockNum) {
-  // find the buffer index corresponding to the block using getBufferNum().
-  int bufferNum = getBufferNum(blockNum);
+/*
+Used to check that a buffer has not changed since its version was taken (with
+findBuffer()), ie. that whatever was read from it since is consistent.
+*/
+bool StaticBuffer::validateVersion(int bufferNum, unsigned int version) {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return metainfo[bufferNum].version.load(std::memory_order_relaxed) == version;
+}
+
+/*
+Used to start changing a buffer: the contents of a buffer being written to
+(under its exclusive latch, see WriteLatch) or the block a buffer holds (under
+the shard's lock, while the buffer is not pinned). The version is odd until
+endChange(), so that optimistic reads overlapping the change are retried.
+endChange() also takes the header of the block from the buffer again (see
+BufferMetaInfo::head).
+*/
+void StaticBuffer::beginChange(int bufferNum) {
+  std::atomic<unsigned int> *version = &metainfo[bufferNum].version;
+  version->store(version->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void StaticBuffer::endChange(int bufferNum) {
+  memcpy(&metainfo[bufferNum].head, metainfo[bufferNum].data, sizeof(struct HeadInfo));
+
+  std::atomic<unsigned int> *version = &metainfo[bufferNum].version;
+  version->store(version->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/*
+Used to give a buffer back (after its block is released, or could not be
+read), so that the block is no longer found in it.
+(the lock of the buffer's shard must be held)
+*/
+void StaticBuffer::freeBuffer(int bufferNum) {
+  if (metainfo[bufferNum].free) {
+    return;
+  }
+  BufferShard *shard = &shards[metainfo[bufferNum].shard];
+  // (a buffer whose block could not be loaded is in the middle of a change)
+  if ((metainfo[bufferNum].version & 1) == 0) {
+    beginChange(bufferNum);
+  }
+  hashRemove(shard, metainfo[bufferNum].blockNum);
+  shard->policy->remove(bufferNum, metainfo[bufferNum].blockNum);
+  shard->freeBuffers[shard->numFreeBuffers++] = bufferNum;
+  if (metainfo[bufferNum].dirty) {
+    numDirty--;
+  }
 
-  // if block is not present in the buffer (bufferNum = E_BLOCKNOTINBUFFER)
-  //     return E_BLOCKNOTINBUFFER
-  if (bufferNum == E_BLOCKNOTINBUFFER) {
-    return E_BLOCKNOTINBUFFER;
+  metainfo[bufferNum].free = true;
+  metainfo[bufferNum].dirty = false;
+  metainfo[bufferNum].blockNum = -1;
+  metainfo[bufferNum].readAhead = false;
+  metainfo[bufferNum].pinCount = 0;
+  endChange(bufferNum);
+}
+
+// home slot of a block in the shard's hash table (Fibonacci hashing, which
+// spreads out runs of consecutive block numbers)
+int StaticBuffer::hashSlot(BufferShard *shard, int blockNum) {
+  return ((uint32_t)blockNum * 2654435769u) >> (32 - shard->hashBits);
+}
+
+/*
+The hash table of a shard is an open addressing table with linear probing; it
+is kept at most half full (hashSize >= 2 * capacity), so a lookup checks one or
+two adjacent slots whatever the size of the buffer.
+*/
+void StaticBuffer::hashInsert(BufferShard *shard, int blockNum, int bufferNum) {
+  int slot = hashSlot(shard, blockNum);
+  while (shard->hash[slot].blockNum != -1) {
+    slot = (slot + 1) & (shard->hashSize - 1);
+  }
+  shard->hash[slot].bufferNum = bufferNum;
+  shard->hash[slot].blockNum = blockNum;
+}
+
+/*
+Removes blockNum from the shard's hash table. The entries after it in the probe
+sequence are moved back into the hole when their home slot allows it, so that
+no tombstones are needed.
+*/
+void StaticBuffer::hashRemove(BufferShard *shard, int blockNum) {
+  int mask = shard->hashSize - 1;
+  int hole = hashSlot(shard, blockNum);
+  while (shard->hash[hole].blockNum != blockNum) {
+    if (shard->hash[hole].blockNum == -1) {
+      return;
+    }
+    hole = (hole + 1) & mask;
+  }
+
+  int slot = hole;
+  while (true) {
+    slot = (slot + 1) & mask;
+    if (shard->hash[slot].blockNum == -1) {
+      break;
+    }
+    // the entry may fill the hole unless its home slot lies cyclically in
+    // (hole, slot]
+    int home = hashSlot(shard, shard->hash[slot].blockNum);
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      shard->hash[hole].bufferNum = (int)shard->hash[slot].bufferNum;
+      shard->hash[hole].blockNum = (int)shard->hash[slot].blockNum;
+      hole = slot;
+    }
   }
+  shard->hash[hole].blockNum = -1;
+}
 
-  // if blockNum is out of bound (bufferNum = E_OUTOFBOUND)
-  //     return E_OUTOFBOUND
-  if (bufferNum == E_OUTOFBOUND) {
+int StaticBuffer::setDirtyBit(int blockNum) {
+  // if blockNum is out of bound return E_OUTOFBOUND
+  if (blockNum < 0 || blockNum >= DISK_BLOCKS) {
     return E_OUTOFBOUND;
   }
 
-  // else
-  //     (the bufferNum is valid)
-  //     set the dirty bit of that buffer to true in metainfo
-  metainfo[bufferNum].dirty = true;
+  bool flush = false;
+  {
+    BufferShard *shard = getShard(blockNum);
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    // find the buffer index corresponding to the block using getBufferNum().
+    int bufferNum = getBufferNum(blockNum);
+
+    // if block is not present in the buffer (bufferNum = E_BLOCKNOTINBUFFER)
+    //     return E_BLOCKNOTINBUFFER
+    if (bufferNum == E_BLOCKNOTINBUFFER) {
+      return E_BLOCKNOTINBUFFER;
+    }
+
+    // else
+    //     (the bufferNum is valid)
+    //     set the dirty bit of that buffer to true in metainfo
+    //     (once more than Config::flusherDirtyRatio percent of the buffers are
+    //     dirty, cold dirty blocks are handed to the flusher)
+    if (!metainfo[bufferNum].dirty) {
+      metainfo[bufferNum].dirty = true;
+      numDirty++;
+      flush = Flusher::isRunning() && numDirty * 100 > Config::flusherDirtyRatio * capacity;
+    }
+  }
+
+  if (flush) {
+    flushDirty();
+  }
 
   // return SUCCESS
   return SUCCESS;
 }
 
+/*
+Used to bring the number of dirty buffers down to half of the dirty ratio
+target (see --flusher). Dirty buffers that are unpinned and cold are chosen,
+least recently used first (shard by shard); copies of their blocks are queued
+for the flusher in block number order and the buffers are marked clean, so that
+replacing them later needs no write. Blocks whose previous copy is still
+queued are left dirty.
+*/
+void StaticBuffer::flushDirty() {
+  int lowWater = Config::flusherDirtyRatio * capacity / 200;
+
+  for (int shardIndex = 0; shardIndex < numShards && numDirty > lowWater; shardIndex++) {
+    BufferShard *shard = &shards[shardIndex];
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    int candidates[shard->capacity];
+    int numCandidates = 0;
+    for (int i = 0; i < shard->capacity; i++) {
+      int bufferIndex = shard->firstBuffer + i;
+      if (!metainfo[bufferIndex].free && metainfo[bufferIndex].dirty &&
+          metainfo[bufferIndex].pinCount == 0 && isCold(bufferIndex) &&
+          !Flusher::isQueued(metainfo[bufferIndex].blockNum)) {
+        candidates[numCandidates++] = bufferIndex;
+      }
+    }
+
+    // (the timeStamps are compared relative to accessCount, which may wrap)
+    std::sort(candidates, candidates + numCandidates, [shard](int a, int b) {
+      return shard->accessCount - (unsigned int)metainfo[a].timeStamp >
+             shard->accessCount - (unsigned int)metainfo[b].timeStamp;
+    });
+    int numToFlush = std::min({numCandidates, numDirty - lowWater, MAX_FLUSH_BLOCKS});
+    if (numToFlush <= 0) {
+      continue;
+    }
+    std::sort(candidates, candidates + numToFlush, [](int a, int b) {
+      return metainfo[a].blockNum < metainfo[b].blockNum;
+    });
+
+    unsigned char *blocksToFlush[numToFlush];
+    int blockNums[numToFlush];
+    for (int i = 0; i < numToFlush; i++) {
+      blocksToFlush[i] = metainfo[candidates[i]].data;
+      blockNums[i] = metainfo[candidates[i]].blockNum;
+    }
+
+    int numQueued = Flusher::enqueue(blocksToFlush, blockNums, numToFlush);
+    for (int i = 0; i < numQueued; i++) {
+      metainfo[candidates[i]].dirty = false;
+      count(candidates[i], &BufferCounters::flushed);
+    }
+    numDirty -= numQueued;
+  }
+}
+
 int StaticBuffer::getStaticBlockType(int blockNum) {
   // Check if blockNum is valid (non zero and less than number of disk blocks)
   // and return E_OUTOFBOUND if not valid.
@@ -166,5 +1187,150 @@ int StaticBuffer::getStaticBlockType(int blockNum) {
 
   // Access the entry in block allocation map corresponding to the blockNum
   // argument and return the block type after type casting to integer.
+  std::lock_guard<std::mutex> guard(allocMapLock);
   return (int)blockAllocMap[blockNum];
 }
+
+/*
+Used to count an event (one of the BufferCounters) for the block in a buffer,
+in the counters of the buffer's shard: in total, for the type of the block and
+for the relation it was last used for.
+(the lock of the buffer's shard must be held)
+*/
+void StaticBuffer::count(int bufferNum, unsigned long BufferCounters::*counter) {
+  struct BufferStats *stats = &shards[metainfo[bufferNum].shard].stats;
+  stats->total.*counter += 1;
+  if (metainfo[bufferNum].blockType >= 0 && metainfo[bufferNum].blockType <= BMAP) {
+    stats->byType[metainfo[bufferNum].blockType].*counter += 1;
+  }
+  if (metainfo[bufferNum].relation != -1) {
+    stats->byRelation[metainfo[bufferNum].relation].*counter += 1;
+  }
+}
+
+/*
+Used to count a hit of an optimistic read, which holds no lock. The hits are
+counted by each thread for itself, and added to the shared counters every
+STATS_BATCH hits (and when the stats are read), so that threads reading the
+same blocks do not share counters either.
+*/
+void StaticBuffer::countOptimisticHit(int blockType) {
+  if (blockType < 0 || blockType > BMAP) {
+    return;
+  }
+  pendingHits.byType[blockType]++;
+  if (statsRelation != -1) {
+    pendingHits.byRelation[statsRelation]++;
+  }
+  if (++pendingHits.count >= STATS_BATCH) {
+    addPendingHits();
+  }
+}
+
+void StaticBuffer::addPendingHits() {
+  std::lock_guard<std::mutex> guard(statsLock);
+  for (int type = 0; type <= BMAP; type++) {
+    optimisticStats.total.hits += pendingHits.byType[type];
+    optimisticStats.byType[type].hits += pendingHits.byType[type];
+  }
+  for (int relation = 0; relation < MAX_STATS_RELATIONS; relation++) {
+    optimisticStats.byRelation[relation].hits += pendingHits.byRelation[relation];
+  }
+  pendingHits = PendingHits();
+}
+
+/*
+Used to count the use of the buffer for the relation opened as relId against
+relName from now on (see RelationStatsScope). The counters of a relation are
+kept when it is closed, and go on if it is opened again; upto
+MAX_STATS_RELATIONS relations are counted in a session.
+*/
+void StaticBuffer::setRelationName(int relId, char relName[ATTR_SIZE]) {
+  if (relId < 0 || relId >= MAX_OPEN) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(statsLock);
+  int relation = 0;
+  while (relation < numStatsRelations && strcmp(statsRelNames[relation], relName) != 0) {
+    relation++;
+  }
+  if (relation == numStatsRelations) {
+    if (numStatsRelations == MAX_STATS_RELATIONS) {
+      statsRelationOf[relId] = -1;
+      return;
+    }
+    strcpy(statsRelNames[relation], relName);
+    numStatsRelations++;
+  }
+  statsRelationOf[relId] = relation;
+}
+
+static void addCounters(struct BufferCounters *to, struct BufferCounters *from) {
+  to->hits += from->hits;
+  to->misses += from->misses;
+  to->readAheads += from->readAheads;
+  to->evictions += from->evictions;
+  to->writeBacks += from->writeBacks;
+  to->flushed += from->flushed;
+  to->committed += from->committed;
+}
+
+static void addStats(struct BufferStats *to, struct BufferStats *from) {
+  addCounters(&to->total, &from->total);
+  for (int type = 0; type <= BMAP; type++) {
+    addCounters(&to->byType[type], &from->byType[type]);
+  }
+  for (int relation = 0; relation < MAX_STATS_RELATIONS; relation++) {
+    addCounters(&to->byRelation[relation], &from->byRelation[relation]);
+  }
+}
+
+/*
+Used to get the counters of the buffer since the start of the session or the
+last resetStats(), and the names of the relations counted (relNames must have
+room for MAX_STATS_RELATIONS names). Returns the number of relations counted,
+which are stats->byRelation[0] onwards.
+(Optimistic hits counted by other threads since their last STATS_BATCH hits
+are not included.)
+*/
+int StaticBuffer::getStats(struct BufferStats *stats, char relNames[][ATTR_SIZE]) {
+  addPendingHits();
+  *stats = BufferStats();
+
+  for (int shardIndex = 0; shardIndex < numShards; shardIndex++) {
+    std::lock_guard<std::mutex> guard(shards[shardIndex].lock);
+    addStats(stats, &shards[shardIndex].stats);
+  }
+
+  std::lock_guard<std::mutex> guard(statsLock);
+  addStats(stats, &optimisticStats);
+  for (int relation = 0; relation < numStatsRelations; relation++) {
+    strcpy(relNames[relation], statsRelNames[relation]);
+  }
+  return numStatsRelations;
+}
+
+void StaticBuffer::resetStats() {
+  for (int shardIndex = 0; shardIndex < numShards; shardIndex++) {
+    std::lock_guard<std::mutex> guard(shards[shardIndex].lock);
+    shards[shardIndex].stats = BufferStats();
+  }
+
+  std::lock_guard<std::mutex> guard(statsLock);
+  optimisticStats = BufferStats();
+  pendingHits = PendingHits();
+}
+
+RelationStatsScope::RelationStatsScope(int relId) {
+  this->previous = StaticBuffer::statsRelation;
+  if (relId >= 0 && relId < MAX_OPEN) {
+    StaticBuffer::statsRelation = StaticBuffer::statsRelationOf[relId].load(std::memory_order_relaxed);
+  } else {
+    StaticBuffer::statsRelation = -1;
+  }
+}
+
+RelationStatsScope::~RelationStatsScope() {
+  StaticBuffer::statsRelation = this->previous;
+}
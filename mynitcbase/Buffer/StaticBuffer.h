@@ -1,35 +1,240 @@
 #ifndef NITCBASE_STATICBUFFER_H
 #define NITCBASE_STATICBUFFER_H
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+#include "../Disk_Class/AsyncIO.h"
 #include "../Disk_Class/Disk.h"
 #include "../define/constants.h"
+#include "ReplacementPolicy.h"
+
+// the header of a block, as laid out at the start of the block
+struct HeadInfo {
+  int32_t blockType;
+  int32_t pblock;
+  int32_t lblock;
+  int32_t rblock;
+  int32_t numEntries;
+  int32_t numAttrs;
+  int32_t numSlots;
+  unsigned char reserved[4];
+};
+
+// counts of the use of the buffer (see StaticBuffer::getStats() and STATS)
+struct BufferCounters {
+  unsigned long hits;        // accesses finding the block in the buffer
+  unsigned long misses;      // accesses reading the block from the disk
+  unsigned long readAheads;  // blocks read ahead of their use
+  unsigned long evictions;   // blocks replaced by other blocks
+  unsigned long writeBacks;  // dirty blocks written back when replaced
+  unsigned long flushed;     // dirty blocks handed to the flusher
+  unsigned long committed;   // dirty blocks written by a commit
+};
+
+// the counters of the buffer in total, by the type of the blocks (as in the
+// block allocation map) and by the relation the blocks were used for (see
+// RelationStatsScope)
+struct BufferStats {
+  struct BufferCounters total;
+  struct BufferCounters byType[BMAP + 1];
+  struct BufferCounters byRelation[MAX_STATS_RELATIONS];
+};
 
 struct BufferMetaInfo {
   bool free;
   bool dirty;
-  int blockNum;
-  int timeStamp;
+  std::atomic<int> blockNum;  // (read without the shard's lock by optimistic reads)
+  int timeStamp;         // value of the shard's accessCount at the last use
+  unsigned char *data;  // contents of the block: blocks[bufferIndex], or the
+                        // block's page in the disk mapping (mmap backend)
+  int pendingRead;      // asynchronous read of the block into data that has not
+                        // been waited for (ASYNC_NO_REQUEST if none)
+  std::atomic<bool> readAhead;  // the block was read ahead and has not been used yet
+  std::atomic<int> pinCount;  // number of pins keeping the block in the buffer
+                              // (see BlockPin); a pinned block is never replaced
+  int shard;            // index of the shard the buffer belongs to
+  int blockType;        // type of the block when it was loaded (for the stats)
+  int relation;         // relation the block was last used for (index into the
+                        // relations counted, or -1)
+  std::shared_mutex latch;  // held while the contents of the block are accessed,
+                            // shared to read and exclusive to modify them
+  // odd while the contents of the buffer (or the block it holds) are being
+  // changed, and moved on by every change (see OptimisticRead)
+  std::atomic<unsigned int> version;
+  // the header of the block, copied out of data by every change (see
+  // endChange()), so that readers do not decode it again and again
+  struct HeadInfo head;
+  // set by optimistic reads, which do not tell the replacement policy of their
+  // use (see getVictimBuffer())
+  std::atomic<bool> referenced;
+};
+
+// a slot of the hash table from block numbers to buffer indices (changed with
+// the shard's lock held, but probed without it by optimistic reads)
+struct BufferHashEntry {
+  std::atomic<int> blockNum;   // -1 if the slot is empty
+  std::atomic<int> bufferNum;
+};
+
+/*
+ * A part of the buffer with its own lock: the buffers firstBuffer to
+ * firstBuffer + capacity - 1, which hold the blocks mapped to the shard (see
+ * StaticBuffer::getShard()). The lock is held while the shard's hash table,
+ * free buffers or replacement policy, or the metainfo of its buffers, are used.
+ */
+struct BufferShard {
+  std::mutex lock;
+  int firstBuffer;
+  int capacity;
+  // the buffer index of every block of the shard in the buffer
+  // (hashSize is a power of 2, at least twice the number of buffers)
+  struct BufferHashEntry *hash;
+  int hashSize;
+  int hashBits;
+  // the buffers that are free (a stack of buffer indices)
+  int *freeBuffers;
+  int numFreeBuffers;
+  // chooses the buffer to be replaced (see Config::replacementPolicy)
+  ReplacementPolicy *policy;
+  // number of accesses to blocks of the shard so far
+  unsigned int accessCount;
+  // the counters of the shard (see StaticBuffer::count())
+  struct BufferStats stats;
+};
+
+// blocks reserved for the record blocks a relation gets next (see --extent):
+// the blocks next to end - 1, which are used in order (none if next == end)
+struct Extent {
+  int next;
+  int end;
+};
+
+// blocks allocated together (see StaticBuffer::claimFreeBlocks()), handed out
+// in order to the new blocks made from them (blockNums[next] is the next one)
+struct ClaimedBlocks {
+  int *blockNums;
+  int count;
+  int next;
+};
+
+// a scan walking a chain of blocks (REC or IND_LEAF) through rblock links
+struct ChainWalk {
+  int lastBlock;  // the last block of the chain that was accessed (-1 if unused)
+  int rblock;     // the next block in the chain
+  int steps;      // number of consecutive steps along the chain seen
+  int ahead;      // number of blocks of the chain read ahead past lastBlock
+  int lastUse;    // value of chainAccessCount at the last access
 };
 
 class StaticBuffer {
   friend class BlockBuffer;
+  friend class BlockPin;
+  friend class OptimisticRead;
+  friend class WriteLatch;
+  friend class RelationStatsScope;
 
  private:
   // fields
-  static unsigned char blocks[BUFFER_CAPACITY][BLOCK_SIZE];
-  static struct BufferMetaInfo metainfo[BUFFER_CAPACITY];
+  // number of buffers (Config::bufferCapacity)
+  static int capacity;
+  // memory of the buffers, mapped once for the session (see allocateBlocks())
+  static unsigned char (*blocks)[BLOCK_SIZE];
+  static size_t blocksSize;
+  static struct BufferMetaInfo *metainfo;
   static unsigned char blockAllocMap[DISK_BLOCKS];
+  // the block allocation map as of the last commit
+  static unsigned char committedAllocMap[DISK_BLOCKS];
+  // held while blockAllocMap (and the BlockAllocator mirroring it) is used
+  static std::mutex allocMapLock;
+  // the shards of the buffer (numShards is a power of 2)
+  static struct BufferShard *shards;
+  static int numShards;
+  // number of buffers holding a dirty block
+  static std::atomic<int> numDirty;
+  // the chains of blocks being walked (see trackAccess()), used with
+  // chainLock held
+  static struct ChainWalk chainWalks[MAX_CHAIN_WALKS];
+  static int chainAccessCount;
+  static std::mutex chainLock;
+  // the relations the use of the buffer is counted for, and the one of them
+  // each open relation is (-1 if none), changed with statsLock held
+  static char statsRelNames[MAX_STATS_RELATIONS][ATTR_SIZE];
+  static int numStatsRelations;
+  static std::atomic<int> statsRelationOf[MAX_OPEN];
+  // hits of optimistic reads (only hits are counted), used with statsLock held
+  static struct BufferStats optimisticStats;
+  static std::mutex statsLock;
+  // relation the accesses of the thread are counted for (see RelationStatsScope)
+  static thread_local int statsRelation;
 
   // methods
+  static BufferShard *getShard(int blockNum);
+  static int pinBlock(int blockNum);
+  static void unpinBuffer(int bufferNum);
+  static int loadEmptyBlock(int blockNum);
+  static int claimFreeBlock(int blockType);
+  static int claimFreeBlocks(int blockType, int count, int blockNums[]);
+  static int claimExtentBlock(int blockType, struct Extent *extent);
+  static void releaseBlock(int blockNum);
+  static void setStaticBlockType(int blockNum, int blockType);
   static int getFreeBuffer(int blockNum);
   static int getBufferNum(int blockNum);
+  static int findBuffer(int blockNum, unsigned int *version);
+  static bool validateVersion(int bufferNum, unsigned int version);
+  static void beginChange(int bufferNum);
+  static void endChange(int bufferNum);
+  static void allocateBlocks();
+  static int getVictimBuffer(BufferShard *shard);
+  static int evictBuffer(int bufferNum);
+  static void freeBuffer(int bufferNum);
+  static void recordAccess(int bufferNum);
+  static bool canEvict(int bufferNum);
+  static bool isUnpinned(int bufferNum);
+  static bool isCold(int bufferNum);
+  static int hashSlot(BufferShard *shard, int blockNum);
+  static void hashInsert(BufferShard *shard, int blockNum, int bufferNum);
+  static void hashRemove(BufferShard *shard, int blockNum);
+  static void trackAccess(int bufferNum);
+  static int readAhead(int bufferNum);
+  static int prefetchShard(BufferShard *shard, int blockNums[], int count);
+  static void flushDirty();
+  static int commitShards();
+  static void count(int bufferNum, unsigned long BufferCounters::*counter);
+  static void countOptimisticHit(int blockType);
+  static void addPendingHits();
 
  public:
   // methods
   static int getStaticBlockType(int blockNum);
   static int setDirtyBit(int blockNum);
+  static int commit();
+  static int prefetch(int blockNums[], int count);
+  static void setRelationName(int relId, char relName[ATTR_SIZE]);
+  static int getStats(struct BufferStats *stats, char relNames[][ATTR_SIZE]);
+  static void resetStats();
+  static void releaseExtent(struct Extent *extent);
   StaticBuffer();
   ~StaticBuffer();
 };
 
+/*
+ * Guard counting the use of the buffer, for the lifetime of the guard, against
+ * the relation open as relId (see StaticBuffer::setRelationName()). Guards may
+ * be nested; the innermost one counts. The blocks replaced or written are
+ * counted against the relation they were last pinned for.
+ */
+class RelationStatsScope {
+ private:
+  int previous;
+
+ public:
+  RelationStatsScope(int relId);
+  ~RelationStatsScope();
+  RelationStatsScope(const RelationStatsScope &) = delete;
+  RelationStatsScope &operator=(const RelationStatsScope &) = delete;
+};
+
 #endif  // NITCBASE_STATICBUFFER_H
@@ -31,6 +31,8 @@ OpenRelTable::OpenRelTable() {
   RelCacheTable::recordToRelCatEntry(relCatRecord, &relCacheEntry.relCatEntry);
   relCacheEntry.recId.block = RELCAT_BLOCK;
   relCacheEntry.recId.slot = RELCAT_SLOTNUM_FOR_RELCAT;
+  relCacheEntry.extent.next = relCacheEntry.extent.end = -1;
+  relCacheEntry.scanCursor = new ScanCursor();
 
   // allocate this on the heap because we want it to persist outside this
   // function
@@ -46,6 +48,7 @@ OpenRelTable::OpenRelTable() {
   RelCacheTable::recordToRelCatEntry(relCatRecord, &relCacheEntry.relCatEntry);
   relCacheEntry.recId.block = RELCAT_BLOCK;
   relCacheEntry.recId.slot = RELCAT_SLOTNUM_FOR_ATTRCAT;
+  relCacheEntry.scanCursor = new ScanCursor();
 
   // set the value at RelCacheTable::relCache[ATTRCAT_RELID]
   RelCacheTable::relCache[ATTRCAT_RELID] =
@@ -137,6 +140,10 @@ OpenRelTable::OpenRelTable() {
 
   strcpy(OpenRelTable::tableMetaInfo[RELCAT_RELID].relName, RELCAT_RELNAME);
   strcpy(OpenRelTable::tableMetaInfo[ATTRCAT_RELID].relName, ATTRCAT_RELNAME);
+
+  // count the use of the buffer for the catalogs (see STATS)
+  StaticBuffer::setRelationName(RELCAT_RELID, OpenRelTable::tableMetaInfo[RELCAT_RELID].relName);
+  StaticBuffer::setRelationName(ATTRCAT_RELID, OpenRelTable::tableMetaInfo[ATTRCAT_RELID].relName);
 }
 
 OpenRelTable::~OpenRelTable() {
@@ -171,7 +178,10 @@ OpenRelTable::~OpenRelTable() {
     // Write back to the buffer using relCatBlock.setRecord() with recId.slot
     relCatBlock.setRecord(relCatRecord, recId.slot);
   }
-  // free the memory dynamically allocated to this RelCacheEntry
+  // free the memory dynamically allocated to this RelCacheEntry (and the
+  // blocks reserved for the attribute catalog)
+  StaticBuffer::releaseExtent(&RelCacheTable::relCache[ATTRCAT_RELID]->extent);
+  delete RelCacheTable::relCache[ATTRCAT_RELID]->scanCursor;
   free(RelCacheTable::relCache[ATTRCAT_RELID]);
 
   // releasing the relation cache entry of the relation catalog
@@ -193,6 +203,7 @@ OpenRelTable::~OpenRelTable() {
     relCatBlock.setRecord(relCatRecord, recId.slot);
   }
   // free the memory dynamically allocated for this RelCacheEntry
+  delete RelCacheTable::relCache[RELCAT_RELID]->scanCursor;
   free(RelCacheTable::relCache[RELCAT_RELID]);
 
   // free the memory allocated for the attribute cache entries of the
@@ -316,6 +327,8 @@ int OpenRelTable::openRel(char relName[ATTR_SIZE]) {
   RelCacheEntry relCacheEntry;
   RelCacheTable::recordToRelCatEntry(relCatRec, &relCacheEntry.relCatEntry);
   relCacheEntry.recId = relcatRecId;
+  relCacheEntry.extent.next = relCacheEntry.extent.end = -1;
+  relCacheEntry.scanCursor = new ScanCursor();
   RelCacheTable::relCache[relId] =
       (struct RelCacheEntry *)malloc(sizeof(RelCacheEntry));
   *(RelCacheTable::relCache[relId]) = relCacheEntry;
@@ -385,6 +398,7 @@ int OpenRelTable::openRel(char relName[ATTR_SIZE]) {
   OpenRelTable::tableMetaInfo[relId].free = false;
   // relName as the input.
   strcpy(OpenRelTable::tableMetaInfo[relId].relName, relName);
+  StaticBuffer::setRelationName(relId, relName);
 
   return relId;
 }
@@ -424,8 +438,12 @@ int OpenRelTable::closeRel(int relId) {
     relCatBlock.setRecord(record, recId.slot);
   }
 
+  // give back the blocks reserved for the relation that it did not use
+  StaticBuffer::releaseExtent(&RelCacheTable::relCache[relId]->extent);
+
   // free the memory allocated in the relation and attribute caches which was
   // allocated in the OpenRelTable::openRel() function
+  delete RelCacheTable::relCache[relId]->scanCursor;
   free(RelCacheTable::relCache[relId]);
 
   /****** Releasing the Attribute Cache entry of the relation ******/
@@ -463,3 +481,44 @@ int OpenRelTable::closeRel(int relId) {
 
   return SUCCESS;
 }
+
+/*
+Used to write the modified relation and attribute cache entries of all the open
+relations (including the catalogs) back to the catalog blocks in the buffer,
+without closing the relations. The entries are no longer dirty after this.
+*/
+int OpenRelTable::writeBack() {
+  for (int relId = 0; relId < MAX_OPEN; relId++) {
+    if (OpenRelTable::tableMetaInfo[relId].free) {
+      continue;
+    }
+
+    RelCacheEntry *relCacheEntry = RelCacheTable::relCache[relId];
+    if (relCacheEntry->dirty) {
+      Attribute record[RELCAT_NO_ATTRS];
+      RelCacheTable::relCatEntryToRecord(&relCacheEntry->relCatEntry, record);
+      RecBuffer relCatBlock(relCacheEntry->recId.block);
+      int ret = relCatBlock.setRecord(record, relCacheEntry->recId.slot);
+      if (ret != SUCCESS) {
+        return ret;
+      }
+      relCacheEntry->dirty = false;
+    }
+
+    for (AttrCacheEntry *entry = AttrCacheTable::attrCache[relId];
+         entry != nullptr; entry = entry->next) {
+      if (entry->dirty) {
+        Attribute record[ATTRCAT_NO_ATTRS];
+        AttrCacheTable::attrCatEntryToRecord(&entry->attrCatEntry, record);
+        RecBuffer attrCatBlock(entry->recId.block);
+        int ret = attrCatBlock.setRecord(record, entry->recId.slot);
+        if (ret != SUCCESS) {
+          return ret;
+        }
+        entry->dirty = false;
+      }
+    }
+  }
+
+  return SUCCESS;
+}
@@ -21,6 +21,7 @@ class OpenRelTable {
   static int getRelId(char relName[ATTR_SIZE]);
   static int openRel(char relName[ATTR_SIZE]);
   static int closeRel(int relId);
+  static int writeBack();
 
  private:
   // field
@@ -97,6 +97,50 @@ int RelCacheTable::resetSearchIndex(int relId) {
   return setSearchIndex(relId, &searchIndex);
 }
 
+/* will return the scan cursor of the relation corresponding to relId, which
+holds the record block the search index is in (see BlockAccess::linearSearch())
+*/
+int RelCacheTable::getScanCursor(int relId, ScanCursor **scanCursor) {
+  if (relId < 0 || relId >= MAX_OPEN) {
+    return E_OUTOFBOUND;
+  }
+  if (relCache[relId] == nullptr) {
+    return E_RELNOTOPEN;
+  }
+
+  *scanCursor = relCache[relId]->scanCursor;
+  return SUCCESS;
+}
+
+/* will return the extent of the relation corresponding to relId (the blocks
+reserved for its next record blocks, see BlockAccess::insert())
+NOTE: this function expects the caller to allocate memory for `*extent`
+*/
+int RelCacheTable::getExtent(int relId, struct Extent *extent) {
+  if (relId < 0 || relId >= MAX_OPEN) {
+    return E_OUTOFBOUND;
+  }
+  if (relCache[relId] == nullptr) {
+    return E_RELNOTOPEN;
+  }
+
+  *extent = relCache[relId]->extent;
+  return SUCCESS;
+}
+
+// sets the extent of the relation corresponding to relId
+int RelCacheTable::setExtent(int relId, struct Extent *extent) {
+  if (relId < 0 || relId >= MAX_OPEN) {
+    return E_OUTOFBOUND;
+  }
+  if (relCache[relId] == nullptr) {
+    return E_RELNOTOPEN;
+  }
+
+  relCache[relId]->extent = *extent;
+  return SUCCESS;
+}
+
 int RelCacheTable::setRelCatEntry(int relId, RelCatEntry *relCatBuf) {
 
   /*relId is outside the range [0, MAX_OPEN-1]*/
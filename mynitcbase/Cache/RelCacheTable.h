@@ -5,6 +5,8 @@
 #include "../define/constants.h"
 #include "../define/id.h"
 
+class ScanCursor;
+
 typedef struct RelCatEntry {
   char relName[ATTR_SIZE];
   int numAttrs;
@@ -20,6 +22,9 @@ typedef struct RelCacheEntry {
   bool dirty;
   RecId recId;
   RecId searchIndex;
+  struct Extent extent;  // blocks reserved for the relation's next record blocks
+  ScanCursor *scanCursor;  // the block the scan at searchIndex is at (see
+                           // BlockAccess::linearSearch())
 
 } RelCacheEntry;
 
@@ -33,6 +38,9 @@ class RelCacheTable {
   static int getSearchIndex(int relId, RecId *searchIndex);
   static int setSearchIndex(int relId, RecId *searchIndex);
   static int resetSearchIndex(int relId);
+  static int getScanCursor(int relId, ScanCursor **scanCursor);
+  static int getExtent(int relId, struct Extent *extent);
+  static int setExtent(int relId, struct Extent *extent);
 
  private:
   // field
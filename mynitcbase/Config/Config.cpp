@@ -0,0 +1,137 @@
+#include "Config.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int Config::diskBackend = DISK_BACKEND_PREAD;
+int Config::ioBackend = IO_BACKEND_SYNC;
+int Config::readAheadBlocks = READ_AHEAD_BLOCKS;
+int Config::replacementPolicy = REPLACEMENT_LRU;
+int Config::bufferCapacity = BUFFER_CAPACITY;
+int Config::hugePages = HUGE_PAGES_OFF;
+int Config::flusherDirtyRatio = 0;
+const char *Config::traceFile = nullptr;
+int Config::extentBlocks = EXTENT_BLOCKS;
+int Config::slotMapFormat = SLOTMAP_BYTES;
+
+/* read a whole number between min and max into *result */
+static bool parseNumber(const char *value, long min, long max, int *result) {
+  char *end;
+  long number = strtol(value, &end, 10);
+  if (end == value || *end != '\0' || number < min || number > max) {
+    return false;
+  }
+  *result = number;
+  return true;
+}
+
+/*
+ * Used to read the session options given on the command line.
+ * Options are of the form --name=value and may appear anywhere in argv:
+ *   --disk=pread|mmap   select the Disk backend
+ *   --io=sync|uring     select synchronous I/O or io_uring
+ *   --readahead=<n>     number of blocks read ahead on chain walks (0 to
+ *                       disable, at most half the number of buffers)
+ *   --replacement=lru|clock|2q
+ *                       select the buffer replacement policy
+ *   --buffers=<n>       number of blocks the buffer holds (MIN_BUFFER_CAPACITY
+ *                       to DISK_BLOCKS)
+ *   --hugepages=off|thp|explicit
+ *                       back the buffer with transparent or reserved huge
+ *                       pages
+ *   --flusher=<n>       write cold dirty blocks in the background once more
+ *                       than n percent of the buffers are dirty (1 to 100;
+ *                       0, the default, leaves the flusher off)
+ *   --extent=<n>        number of consecutive blocks reserved at a time for
+ *                       the record blocks of a relation (1 to MAX_IO_BLOCKS)
+ *   --slotmap=bytes|bitmap
+ *                       slot map format of the record blocks allocated for
+ *                       the relations (the catalogs keep theirs in bytes)
+ *   --trace=<file>      record every access to the buffer in the given file
+ *                       (see AccessTrace and the cachesim tool)
+ * Recognised options are removed from argv (and *argc is updated) so that the
+ * remaining arguments (eg. "run <file>") can be handled by the frontend.
+ * Returns FAILURE (after printing a message) on an unknown option or value.
+ */
+int Config::parseArgs(int *argc, char *argv[]) {
+  int kept = 1;
+  bool readAheadGiven = false;
+
+  for (int i = 1; i < *argc; i++) {
+    char *arg = argv[i];
+
+    // not an option, leave it for the frontend
+    if (strncmp(arg, "--", 2) != 0) {
+      argv[kept++] = arg;
+      continue;
+    }
+
+    if (strcmp(arg, "--disk=pread") == 0) {
+      diskBackend = DISK_BACKEND_PREAD;
+    } else if (strcmp(arg, "--disk=mmap") == 0) {
+      diskBackend = DISK_BACKEND_MMAP;
+    } else if (strcmp(arg, "--io=sync") == 0) {
+      ioBackend = IO_BACKEND_SYNC;
+    } else if (strcmp(arg, "--io=uring") == 0) {
+      ioBackend = IO_BACKEND_URING;
+    } else if (strncmp(arg, "--readahead=", 12) == 0) {
+      if (!parseNumber(arg + 12, 0, DISK_BLOCKS, &readAheadBlocks)) {
+        std::cout << "Invalid option " << arg << std::endl;
+        return FAILURE;
+      }
+      readAheadGiven = true;
+    } else if (strncmp(arg, "--buffers=", 10) == 0) {
+      if (!parseNumber(arg + 10, MIN_BUFFER_CAPACITY, DISK_BLOCKS, &bufferCapacity)) {
+        std::cout << "Invalid option " << arg << std::endl;
+        return FAILURE;
+      }
+    } else if (strncmp(arg, "--flusher=", 10) == 0) {
+      if (!parseNumber(arg + 10, 0, 100, &flusherDirtyRatio)) {
+        std::cout << "Invalid option " << arg << std::endl;
+        return FAILURE;
+      }
+    } else if (strncmp(arg, "--extent=", 9) == 0) {
+      if (!parseNumber(arg + 9, 1, MAX_IO_BLOCKS, &extentBlocks)) {
+        std::cout << "Invalid option " << arg << std::endl;
+        return FAILURE;
+      }
+    } else if (strcmp(arg, "--slotmap=bytes") == 0) {
+      slotMapFormat = SLOTMAP_BYTES;
+    } else if (strcmp(arg, "--slotmap=bitmap") == 0) {
+      slotMapFormat = SLOTMAP_BITMAP;
+    } else if (strncmp(arg, "--trace=", 8) == 0 && arg[8] != '\0') {
+      traceFile = arg + 8;
+    } else if (strcmp(arg, "--hugepages=off") == 0) {
+      hugePages = HUGE_PAGES_OFF;
+    } else if (strcmp(arg, "--hugepages=thp") == 0) {
+      hugePages = HUGE_PAGES_TRANSPARENT;
+    } else if (strcmp(arg, "--hugepages=explicit") == 0) {
+      hugePages = HUGE_PAGES_EXPLICIT;
+    } else if (strcmp(arg, "--replacement=lru") == 0) {
+      replacementPolicy = REPLACEMENT_LRU;
+    } else if (strcmp(arg, "--replacement=clock") == 0) {
+      replacementPolicy = REPLACEMENT_CLOCK;
+    } else if (strcmp(arg, "--replacement=2q") == 0) {
+      replacementPolicy = REPLACEMENT_2Q;
+    } else {
+      std::cout << "Invalid option " << arg << std::endl;
+      return FAILURE;
+    }
+  }
+
+  // a read-ahead window may take at most half of the buffer (the default
+  // window is made smaller for a small buffer)
+  if (!readAheadGiven && readAheadBlocks > bufferCapacity / 2) {
+    readAheadBlocks = bufferCapacity / 2;
+  }
+  if (readAheadBlocks > bufferCapacity / 2) {
+    std::cout << "Invalid option --readahead=" << readAheadBlocks
+              << " (at most half of the " << bufferCapacity << " buffers)" << std::endl;
+    return FAILURE;
+  }
+
+  *argc = kept;
+  argv[kept] = nullptr;
+  return SUCCESS;
+}
@@ -0,0 +1,51 @@
+#ifndef NITCBASE_CONFIG_H
+#define NITCBASE_CONFIG_H
+
+#include "../define/constants.h"
+
+enum DiskBackend {
+  DISK_BACKEND_PREAD = 0,  // positioned reads and writes on the run copy
+  DISK_BACKEND_MMAP = 1,   // the run copy is memory mapped
+};
+
+enum IoBackend {
+  IO_BACKEND_SYNC = 0,   // every read and write is waited for
+  IO_BACKEND_URING = 1,  // buffer misses and write-backs use io_uring
+};
+
+enum ReplacementPolicyType {
+  REPLACEMENT_LRU = 0,    // least recently used (doubly linked list)
+  REPLACEMENT_CLOCK = 1,  // CLOCK (second chance)
+  REPLACEMENT_2Q = 2,     // 2Q (scan resistant)
+};
+
+enum HugePages {
+  HUGE_PAGES_OFF = 0,          // the buffer uses normal pages
+  HUGE_PAGES_TRANSPARENT = 1,  // the buffer asks for transparent huge pages
+  HUGE_PAGES_EXPLICIT = 2,     // the buffer uses reserved huge pages (hugetlbfs)
+};
+
+enum SlotMapFormat {
+  SLOTMAP_BYTES = 0,   // a byte per slot (SLOT_OCCUPIED / SLOT_UNOCCUPIED)
+  SLOTMAP_BITMAP = 1,  // a bit per slot, for more slots in a block
+};
+
+class Config {
+ public:
+  // fields
+  static int diskBackend;
+  static int ioBackend;
+  static int readAheadBlocks;
+  static int replacementPolicy;
+  static int bufferCapacity;
+  static int hugePages;
+  static int flusherDirtyRatio;
+  static const char *traceFile;
+  static int extentBlocks;
+  static int slotMapFormat;
+
+  // methods
+  static int parseArgs(int *argc, char *argv[]);
+};
+
+#endif  // NITCBASE_CONFIG_H
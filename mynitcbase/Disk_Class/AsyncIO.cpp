@@ -0,0 +1,291 @@
+// <linux/io_uring.h> defines a BLOCK_SIZE of its own (through <linux/fs.h>),
+// so it is included first and its definition replaced by the one of nitcbase
+#include <linux/io_uring.h>
+#undef BLOCK_SIZE
+
+#include "AsyncIO.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Disk.h"
+
+/*
+ * An asynchronous transfer. Writes are gathered into `staging` when they are
+ * submitted, so the caller may reuse its memory at once; reads go directly to
+ * the caller's buffer, which must not be touched until wait() returns.
+ */
+struct AsyncRequest {
+  bool inUse;
+  bool done;
+  bool write;
+  int fd;
+  unsigned char *buf;
+  size_t size;
+  off_t offset;
+  int result;  // bytes transferred, or -errno
+  unsigned char staging[ASYNC_STAGING_SIZE];
+};
+
+static AsyncRequest requests[MAX_ASYNC_REQUESTS];
+
+// the rings shared with the kernel (see io_uring_setup(2))
+static unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+static unsigned *cqHead, *cqTail, *cqMask;
+static struct io_uring_sqe *sqes;
+static struct io_uring_cqe *cqes;
+static void *sqRing = MAP_FAILED, *cqRing = MAP_FAILED;
+static size_t sqRingSize, cqRingSize, sqesSize;
+
+int AsyncIO::ringFd = -1;
+
+/*
+ * Used to set up the io_uring instance. Returns FAILURE if io_uring is not
+ * available, in which case all transfers are done synchronously.
+ */
+int AsyncIO::init() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  int fd = syscall(__NR_io_uring_setup, MAX_ASYNC_REQUESTS, &params);
+  if (fd < 0) {
+    return FAILURE;
+  }
+  ringFd = fd;
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+  }
+  sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                fd, IORING_OFF_SQ_RING);
+  if (sqRing != MAP_FAILED) {
+    cqRing = (params.features & IORING_FEAT_SINGLE_MMAP)
+                 ? sqRing
+                 : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  }
+  void *sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqesMap == MAP_FAILED) {
+    if (sqesMap != MAP_FAILED) {
+      munmap(sqesMap, sqesSize);
+    }
+    shutdown();
+    return FAILURE;
+  }
+
+  unsigned char *sq = (unsigned char *)sqRing;
+  unsigned char *cq = (unsigned char *)cqRing;
+  sqHead = (unsigned *)(sq + params.sq_off.head);
+  sqTail = (unsigned *)(sq + params.sq_off.tail);
+  sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+  sqArray = (unsigned *)(sq + params.sq_off.array);
+  cqHead = (unsigned *)(cq + params.cq_off.head);
+  cqTail = (unsigned *)(cq + params.cq_off.tail);
+  cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+  cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  sqes = (struct io_uring_sqe *)sqesMap;
+
+  for (int i = 0; i < MAX_ASYNC_REQUESTS; i++) {
+    requests[i].inUse = false;
+  }
+  return SUCCESS;
+}
+
+/*
+ * Used to tear down the io_uring instance. Every request must have been
+ * waited for.
+ */
+void AsyncIO::shutdown() {
+  if (sqes != nullptr) {
+    munmap(sqes, sqesSize);
+    sqes = nullptr;
+  }
+  if (cqRing != MAP_FAILED && cqRing != sqRing) {
+    munmap(cqRing, cqRingSize);
+  }
+  if (sqRing != MAP_FAILED) {
+    munmap(sqRing, sqRingSize);
+  }
+  sqRing = cqRing = MAP_FAILED;
+
+  if (ringFd != -1) {
+    close(ringFd);
+    ringFd = -1;
+  }
+}
+
+bool AsyncIO::isEnabled() {
+  return ringFd != -1;
+}
+
+/* get a request that is not in use, or -1 if there is none */
+static int getFreeRequest() {
+  for (int i = 0; i < MAX_ASYNC_REQUESTS; i++) {
+    if (!requests[i].inUse) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Used to queue a request on the submission ring and hand it to the kernel.
+ * There are never more requests in flight than ring entries, so the ring
+ * cannot be full.
+ */
+int AsyncIO::submit(int request) {
+  AsyncRequest *req = &requests[request];
+
+  unsigned tail = *sqTail;
+  unsigned index = tail & *sqMask;
+  struct io_uring_sqe *sqe = &sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = req->write ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = req->fd;
+  sqe->addr = (unsigned long)req->buf;
+  sqe->len = req->size;
+  sqe->off = req->offset;
+  sqe->user_data = request;
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+  while (syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, nullptr, 0) < 0) {
+    if (errno != EINTR) {
+      // take the entry back so that the ring stays consistent
+      __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+      return E_DISKIO;
+    }
+  }
+  return SUCCESS;
+}
+
+/*
+ * Used to record the results of the completed requests. If `block` is set and
+ * nothing has completed yet, waits for at least one completion.
+ */
+int AsyncIO::reap(bool block) {
+  unsigned head = *cqHead;
+  if (block && head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+    if (syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+        errno != EINTR) {
+      return E_DISKIO;
+    }
+  }
+
+  while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe *cqe = &cqes[head & *cqMask];
+    AsyncRequest *req = &requests[cqe->user_data];
+    req->result = cqe->res;
+    req->done = true;
+    head++;
+  }
+  __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+  return SUCCESS;
+}
+
+/*
+ * Used to start reading `size` bytes at `offset` into `buf`.
+ * *request is set to the request to wait() for before using `buf`.
+ */
+int AsyncIO::read(int fd, void *buf, size_t size, off_t offset, int *request) {
+  *request = ASYNC_NO_REQUEST;
+
+  int index = isEnabled() ? getFreeRequest() : -1;
+  if (index == -1) {
+    return Disk::readFully(fd, buf, size, offset);
+  }
+
+  AsyncRequest *req = &requests[index];
+  req->inUse = true;
+  req->done = false;
+  req->write = false;
+  req->fd = fd;
+  req->buf = (unsigned char *)buf;
+  req->size = size;
+  req->offset = offset;
+  if (submit(index) != SUCCESS) {
+    req->inUse = false;
+    return Disk::readFully(fd, buf, size, offset);
+  }
+
+  *request = index;
+  return SUCCESS;
+}
+
+/*
+ * Used to start writing the buffers of `iov` (at most ASYNC_STAGING_SIZE bytes
+ * in all) to consecutive bytes at `offset`. The buffers are copied, so they
+ * may be reused as soon as this returns.
+ * *request is set to the request to wait() for to know that the write is done.
+ */
+int AsyncIO::writev(int fd, const struct iovec *iov, int iovcnt, off_t offset, int *request) {
+  *request = ASYNC_NO_REQUEST;
+
+  int index = isEnabled() ? getFreeRequest() : -1;
+  if (index == -1) {
+    struct iovec copy[iovcnt];
+    memcpy(copy, iov, sizeof(copy));
+    return Disk::writevFully(fd, copy, iovcnt, offset);
+  }
+
+  AsyncRequest *req = &requests[index];
+  size_t size = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    memcpy(req->staging + size, iov[i].iov_base, iov[i].iov_len);
+    size += iov[i].iov_len;
+  }
+  req->inUse = true;
+  req->done = false;
+  req->write = true;
+  req->fd = fd;
+  req->buf = req->staging;
+  req->size = size;
+  req->offset = offset;
+  if (submit(index) != SUCCESS) {
+    req->inUse = false;
+    return Disk::writeFully(fd, req->staging, size, offset);
+  }
+
+  *request = index;
+  return SUCCESS;
+}
+
+/*
+ * Used to wait for a request to complete (and release it).
+ * A transfer that completes short is finished synchronously.
+ * Returns E_DISKIO if the transfer failed.
+ */
+int AsyncIO::wait(int request) {
+  if (request == ASYNC_NO_REQUEST) {
+    return SUCCESS;
+  }
+
+  AsyncRequest *req = &requests[request];
+  while (!req->done) {
+    if (reap(true) != SUCCESS) {
+      // the request is still owned by the kernel; it cannot be released
+      return E_DISKIO;
+    }
+  }
+  req->inUse = false;
+  if (req->result < 0) {
+    return E_DISKIO;
+  }
+  size_t done = req->result;
+  if (done == req->size) {
+    return SUCCESS;
+  }
+  if (req->write) {
+    return Disk::writeFully(req->fd, req->buf + done, req->size - done, req->offset + done);
+  }
+  return Disk::readFully(req->fd, req->buf + done, req->size - done, req->offset + done);
+}
@@ -0,0 +1,36 @@
+#ifndef NITCBASE_ASYNCIO_H
+#define NITCBASE_ASYNCIO_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "../define/constants.h"
+
+#define ASYNC_NO_REQUEST -1                // request number of a transfer already done
+#define ASYNC_STAGING_SIZE (BLOCK_SIZE + 16)  // largest write (a block and its log record header)
+
+/*
+ * Asynchronous positioned I/O on Linux io_uring (used through the raw system
+ * calls, so no library is needed).
+ * A transfer is submitted with read() or writev(), which give back a request
+ * number to be passed to wait() later. When io_uring is not available (or all
+ * the requests are in use) the transfer is done synchronously and the request
+ * number is ASYNC_NO_REQUEST, for which wait() returns SUCCESS at once.
+ */
+class AsyncIO {
+ private:
+  static int ringFd;
+
+  static int submit(int request);
+  static int reap(bool block);
+
+ public:
+  static int init();
+  static void shutdown();
+  static bool isEnabled();
+  static int read(int fd, void *buf, size_t size, off_t offset, int *request);
+  static int writev(int fd, const struct iovec *iov, int iovcnt, off_t offset, int *request);
+  static int wait(int request);
+};
+
+#endif  // NITCBASE_ASYNCIO_H
@@ -1,24 +1,133 @@
 #include "Disk.h"
 
-#include <fstream>
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
 
+#include "../Config/Config.h"
+#include "../WAL/WAL.h"
+#include "AsyncIO.h"
 #include "../define/constants.h"
 
+int Disk::diskFd = -1;
+unsigned char *Disk::diskMap = nullptr;
+std::recursive_mutex Disk::ioLock;
+struct DiskStats Disk::stats;
+
+/* read exactly `size` bytes at `offset`; returns E_DISKIO on error or end of file */
+int Disk::readFully(int fd, void *buf, size_t size, off_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, (char *)buf + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return E_DISKIO;
+    }
+    done += n;
+  }
+  return SUCCESS;
+}
+
+/* write exactly `size` bytes at `offset`; returns E_DISKIO on error */
+int Disk::writeFully(int fd, const void *buf, size_t size, off_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pwrite(fd, (const char *)buf + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return E_DISKIO;
+    }
+    done += n;
+  }
+  return SUCCESS;
+}
+
 /*
- * Used to make a temporary copy of the disk contents before the starting of a new session.
- * This ensures that if the system has a forced shutdown during the course of the session,
- * the previous state of the disk is not lost.
+ * transfer all the buffers of `iov` starting at `offset` with as few
+ * preadv/pwritev calls as possible; returns E_DISKIO on error (or end of file).
+ * `iov` is used as scratch space and is modified.
+ */
+static int transferv(int fd, struct iovec *iov, int iovcnt, off_t offset, bool write) {
+  while (iovcnt > 0) {
+    int count = std::min(iovcnt, IOV_MAX);
+    ssize_t n = write ? pwritev(fd, iov, count, offset) : preadv(fd, iov, count, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return E_DISKIO;
+    }
+    offset += n;
+
+    // skip the buffers transferred completely and advance into a partial one
+    while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+      n -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (char *)iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+  return SUCCESS;
+}
+
+/* read the buffers of `iov` from consecutive bytes at `offset` (modifies `iov`) */
+int Disk::readvFully(int fd, struct iovec *iov, int iovcnt, off_t offset) {
+  return transferv(fd, iov, iovcnt, offset, false);
+}
+
+/* write the buffers of `iov` to consecutive bytes at `offset` (modifies `iov`) */
+int Disk::writevFully(int fd, struct iovec *iov, int iovcnt, off_t offset) {
+  return transferv(fd, iov, iovcnt, offset, true);
+}
+
+/*
+ * Used to start a new session.
+ * The disk is opened once; if the previous session left a log behind, its
+ * committed blocks are redone first. Blocks modified during this session are
+ * written to the log (see WAL), so if the system has a forced shutdown during
+ * the course of the session, only the changes that were not committed are lost.
  */
 Disk::Disk() {
-  /* An efficient method to copy files */
-  /* Copy Disk to Disk Run Copy */
-  std::ifstream src(DISK_PATH, std::ios::binary);
-  std::ofstream dst(DISK_RUN_COPY_PATH, std::ios::binary);
+  diskFd = open(DISK_PATH, O_RDWR);
+
+  if (diskFd != -1 && WAL::open(diskFd) != SUCCESS) {
+    // the log could not be recovered: refuse to use the disk until it is
+    close(diskFd);
+    diskFd = -1;
+  }
 
-  dst << src.rdbuf();
-  src.close();
-  dst.close();
+  /* With the mmap backend the whole disk is mapped copy-on-write: the buffer
+     works directly on the mapped pages and the changes never reach the disk
+     file except through the log. If the mapping cannot be made the session
+     silently falls back to positioned I/O on the descriptor. */
+  if (Config::diskBackend == DISK_BACKEND_MMAP && diskFd != -1) {
+    void *map = mmap(nullptr, DISK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                     diskFd, 0);
+    if (map != MAP_FAILED) {
+      diskMap = (unsigned char *)map;
+    }
+  }
+
+  // with the io_uring backend, buffer misses and write-backs can be started
+  // without waiting for them; if io_uring is not available all I/O stays
+  // synchronous
+  if (Config::ioBackend == IO_BACKEND_URING && diskFd != -1) {
+    AsyncIO::init();
+  }
 }
 
 /*
@@ -26,14 +135,30 @@ Disk::Disk() {
  * This ensures that these changes are visible in future sessions.
  */
 Disk::~Disk() {
-  /* An efficient method to copy files */
-  /* Copy Disk Run Copy to Disk */
-  std::ifstream src(DISK_RUN_COPY_PATH, std::ios::binary);
-  std::ofstream dst(DISK_PATH, std::ios::binary);
+  if (diskMap != nullptr) {
+    munmap(diskMap, DISK_SIZE);
+    diskMap = nullptr;
+  }
+
+  if (diskFd != -1) {
+    WAL::close();
+    close(diskFd);
+    diskFd = -1;
+  }
+
+  AsyncIO::shutdown();
+}
 
-  dst << src.rdbuf();
-  src.close();
-  dst.close();
+/*
+ * Used to commit the blocks written since the last commit (see WAL::commit()).
+ */
+int Disk::commit() {
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
+  if (diskFd == -1) {
+    return E_DISKIO;
+  }
+  stats.commits++;
+  return WAL::commit();
 }
 
 /*
@@ -41,17 +166,37 @@ Disk::~Disk() {
  * block - Memory pointer of the buffer to which the block contents is to be loaded/read.
  *         (MUST be Allocated by caller)
  * blockNum - Block number of the disk block to be read.
+ * Returns E_DISKIO if the block could not be read.
  */
 int Disk::readBlock(unsigned char *block, int blockNum) {
-  FILE *disk = fopen(DISK_RUN_COPY_PATH, "rb");
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
   if (blockNum < 0 || blockNum > DISK_BLOCKS - 1) {
     return E_OUTOFBOUND;
   }
-  const int offset = blockNum * BLOCK_SIZE;
-  fseek(disk, offset, SEEK_SET);
-  fread(block, BLOCK_SIZE, 1, disk);
-  fclose(disk);
-  return SUCCESS;
+  stats.reads++;
+  stats.blocksRead++;
+
+  // with the mmap backend, copy out of the mapping (nothing to do if the
+  // caller is already pointing at the mapped block). The mapping already
+  // holds every change made in this session.
+  if (diskMap != nullptr) {
+    unsigned char *mapped = diskMap + (size_t)blockNum * BLOCK_SIZE;
+    if (block != mapped) {
+      memcpy(block, mapped, BLOCK_SIZE);
+    }
+    return SUCCESS;
+  }
+
+  if (diskFd == -1) {
+    return E_DISKIO;
+  }
+
+  // a block modified since the last checkpoint is read from the log
+  int ret = WAL::readBlock(block, blockNum);
+  if (ret != E_BLOCKNOTINBUFFER) {
+    return ret;
+  }
+  return readFully(diskFd, block, BLOCK_SIZE, (off_t)blockNum * BLOCK_SIZE);
 }
 
 /*
@@ -59,15 +204,254 @@ int Disk::readBlock(unsigned char *block, int blockNum) {
  * block - Memory pointer of the buffer to which contain the contents to be written.
  *         (MUST be Allocated by caller)
  * blockNum - Block number of the disk block to be written into.
+ * The block is written to the log; it reaches the disk once it is committed
+ * and the log is checkpointed.
+ * Returns E_DISKIO if the block could not be written.
  */
 int Disk::writeBlock(unsigned char *block, int blockNum) {
-  FILE *disk = fopen(DISK_RUN_COPY_PATH, "rb+");
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
   if (blockNum < 0 || blockNum > DISK_BLOCKS - 1) {
     return E_OUTOFBOUND;
   }
-  const int offset = blockNum * BLOCK_SIZE;
-  fseek(disk, offset, SEEK_SET);
-  fwrite(block, BLOCK_SIZE, 1, disk);
-  fclose(disk);
+  stats.writes++;
+  stats.blocksWritten++;
+
+  if (diskMap != nullptr) {
+    unsigned char *mapped = diskMap + (size_t)blockNum * BLOCK_SIZE;
+    if (block != mapped) {
+      memcpy(mapped, block, BLOCK_SIZE);
+    }
+  }
+
+  return WAL::writeBlock(block, blockNum);
+}
+
+/* positions of blockNums[0..count-1] sorted by block number */
+static std::vector<int> sortedOrder(int blockNums[], int count) {
+  std::vector<int> order(count);
+  for (int i = 0; i < count; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            [blockNums](int a, int b) { return blockNums[a] < blockNums[b]; });
+  return order;
+}
+
+/*
+ * Used to Read a set of blocks from disk
+ * blocks - blocks[i] is the memory pointer to which block blockNums[i] is to be
+ *          read (MUST be Allocated by caller)
+ * blockNums - Block numbers of the disk blocks to be read (in any order)
+ * count - Number of blocks to be read
+ * The blocks are read in block number order; runs of consecutive blocks on the
+ * disk (upto MAX_IO_BLOCKS at a time) are read with a single preadv.
+ * Returns E_OUTOFBOUND (reading nothing) if any block number is invalid, and
+ * E_DISKIO if a block could not be read.
+ */
+int Disk::readBlocks(unsigned char *blocks[], int blockNums[], int count) {
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
+  for (int i = 0; i < count; i++) {
+    if (blockNums[i] < 0 || blockNums[i] > DISK_BLOCKS - 1) {
+      return E_OUTOFBOUND;
+    }
+  }
+  stats.reads++;
+  stats.blocksRead += count;
+
+  if (diskMap != nullptr) {
+    for (int i = 0; i < count; i++) {
+      unsigned char *mapped = diskMap + (size_t)blockNums[i] * BLOCK_SIZE;
+      if (blocks[i] != mapped) {
+        memcpy(blocks[i], mapped, BLOCK_SIZE);
+      }
+    }
+    return SUCCESS;
+  }
+
+  if (diskFd == -1) {
+    return E_DISKIO;
+  }
+
+  std::vector<int> order = sortedOrder(blockNums, count);
+  struct iovec iov[MAX_IO_BLOCKS];
+
+  int i = 0;
+  while (i < count) {
+    int first = blockNums[order[i]];
+
+    // a block modified since the last checkpoint is read from the log
+    if (WAL::isLogged(first)) {
+      int ret = WAL::readBlock(blocks[order[i]], first);
+      if (ret != SUCCESS) {
+        return ret;
+      }
+      i++;
+      continue;
+    }
+
+    // gather the run of consecutive blocks starting at `first`
+    int runLength = 0;
+    while (i + runLength < count && runLength < MAX_IO_BLOCKS &&
+           blockNums[order[i + runLength]] == first + runLength &&
+           !WAL::isLogged(first + runLength)) {
+      iov[runLength].iov_base = blocks[order[i + runLength]];
+      iov[runLength].iov_len = BLOCK_SIZE;
+      runLength++;
+    }
+
+    int ret = readvFully(diskFd, iov, runLength, (off_t)first * BLOCK_SIZE);
+    if (ret != SUCCESS) {
+      return ret;
+    }
+    i += runLength;
+  }
+
   return SUCCESS;
-}
\ No newline at end of file
+}
+
+/*
+ * Used to Write a set of blocks to disk
+ * blocks - blocks[i] is the memory pointer holding the contents of block
+ *          blockNums[i] (MUST be Allocated by caller)
+ * blockNums - Block numbers of the disk blocks to be written (in any order)
+ * count - Number of blocks to be written
+ * The blocks are written to the log in block number order, the new records
+ * with a single pwritev (see WAL::writeBlocks()).
+ * Returns E_OUTOFBOUND (writing nothing) if any block number is invalid, and
+ * E_DISKIO if a block could not be written.
+ */
+int Disk::writeBlocks(unsigned char *blocks[], int blockNums[], int count) {
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
+  for (int i = 0; i < count; i++) {
+    if (blockNums[i] < 0 || blockNums[i] > DISK_BLOCKS - 1) {
+      return E_OUTOFBOUND;
+    }
+  }
+  stats.writes++;
+  stats.blocksWritten += count;
+
+  std::vector<int> order = sortedOrder(blockNums, count);
+  std::vector<unsigned char *> sortedBlocks(count);
+  std::vector<int> sortedBlockNums(count);
+  for (int i = 0; i < count; i++) {
+    sortedBlocks[i] = blocks[order[i]];
+    sortedBlockNums[i] = blockNums[order[i]];
+
+    if (diskMap != nullptr) {
+      unsigned char *mapped = diskMap + (size_t)sortedBlockNums[i] * BLOCK_SIZE;
+      if (sortedBlocks[i] != mapped) {
+        memcpy(mapped, sortedBlocks[i], BLOCK_SIZE);
+      }
+    }
+  }
+
+  return WAL::writeBlocks(sortedBlocks.data(), sortedBlockNums.data(), count);
+}
+
+/*
+ * Used to start reading a block from disk without waiting for it
+ * block - Memory pointer of the buffer to which the block is to be read.
+ *         (MUST be Allocated by caller, and not used until the read is waited for)
+ * blockNum - Block number of the disk block to be read.
+ * request - set to the request to be passed to Disk::wait() (ASYNC_NO_REQUEST
+ *           if the block has already been read)
+ * Without the io_uring backend this is the same as readBlock().
+ */
+int Disk::readBlockAsync(unsigned char *block, int blockNum, int *request) {
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
+  *request = ASYNC_NO_REQUEST;
+  if (blockNum < 0 || blockNum > DISK_BLOCKS - 1) {
+    return E_OUTOFBOUND;
+  }
+  stats.reads++;
+  stats.blocksRead++;
+
+  // with the mmap backend, ask the kernel to start paging the block in (or
+  // copy it out of the mapping right away)
+  if (diskMap != nullptr) {
+    unsigned char *mapped = diskMap + (size_t)blockNum * BLOCK_SIZE;
+    if (block == mapped) {
+      madvise((void *)((uintptr_t)mapped & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1)),
+              BLOCK_SIZE, MADV_WILLNEED);
+    } else {
+      memcpy(block, mapped, BLOCK_SIZE);
+    }
+    return SUCCESS;
+  }
+
+  if (diskFd == -1) {
+    return E_DISKIO;
+  }
+
+  // blocks in the log are few and are read synchronously
+  if (WAL::isLogged(blockNum)) {
+    return WAL::readBlock(block, blockNum);
+  }
+  return AsyncIO::read(diskFd, block, BLOCK_SIZE, (off_t)blockNum * BLOCK_SIZE, request);
+}
+
+/*
+ * Used to start writing a block to disk without waiting for it (see
+ * WAL::writeBlockAsync()). The block may be reused as soon as this returns.
+ * Without the io_uring backend this is the same as writeBlock().
+ */
+int Disk::writeBlockAsync(unsigned char *block, int blockNum) {
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
+  if (blockNum < 0 || blockNum > DISK_BLOCKS - 1) {
+    return E_OUTOFBOUND;
+  }
+  stats.writes++;
+  stats.blocksWritten++;
+
+  if (diskMap != nullptr) {
+    unsigned char *mapped = diskMap + (size_t)blockNum * BLOCK_SIZE;
+    if (block != mapped) {
+      memcpy(mapped, block, BLOCK_SIZE);
+    }
+  }
+
+  return WAL::writeBlockAsync(block, blockNum);
+}
+
+/*
+ * Used to wait for a read started by readBlockAsync().
+ * Returns E_DISKIO if the block could not be read.
+ */
+int Disk::wait(int request) {
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
+  return AsyncIO::wait(request);
+}
+
+/*
+ * Used to check if reads and writes can be started without waiting for them
+ * (ie. the io_uring backend is in use).
+ */
+bool Disk::isAsync() {
+  return AsyncIO::isEnabled();
+}
+
+/*
+ * Used to get the address of a block inside the memory mapping of the disk.
+ * Returns nullptr if the mmap backend is not in use (or blockNum is invalid);
+ * the caller must then keep its own copy of the block using readBlock().
+ */
+unsigned char *Disk::getBlockPtr(int blockNum) {
+  if (diskMap == nullptr || blockNum < 0 || blockNum > DISK_BLOCKS - 1) {
+    return nullptr;
+  }
+  return diskMap + (size_t)blockNum * BLOCK_SIZE;
+}
+
+/*
+ * Used to get the counts of the I/O done since the start of the session or
+ * the last resetStats().
+ */
+struct DiskStats Disk::getStats() {
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
+  return stats;
+}
+
+void Disk::resetStats() {
+  std::lock_guard<std::recursive_mutex> guard(ioLock);
+  stats = DiskStats();
+}
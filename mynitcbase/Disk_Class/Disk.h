@@ -1,10 +1,54 @@
 #ifndef NITCBASE_H
 #define NITCBASE_H
+
+#include <mutex>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "../define/constants.h"
+
+// counts of the I/O done through the disk layer (see STATS)
+struct DiskStats {
+  unsigned long reads;          // calls reading blocks (readBlock(), readBlocks(), readBlockAsync())
+  unsigned long blocksRead;
+  unsigned long writes;         // calls writing blocks (writeBlock(), writeBlocks(), writeBlockAsync())
+  unsigned long blocksWritten;
+  unsigned long commits;
+};
+
 class Disk {
+ private:
+  // descriptor of the disk, opened once for the whole session
+  static int diskFd;
+  // start of the (copy-on-write) memory mapping of the disk (nullptr unless
+  // the mmap backend is in use)
+  static unsigned char *diskMap;
+  // held by every read, write and commit, since the buffer's flusher thread
+  // writes blocks while the buffer reads others (recursive, as readBlocks()
+  // and readBlockAsync() may go through readBlock())
+  static std::recursive_mutex ioLock;
+  // (used with ioLock held)
+  static struct DiskStats stats;
+
  public:
   Disk();
   ~Disk();
   static int readBlock(unsigned char *block, int blockNum);
   static int writeBlock(unsigned char *block, int blockNum);
+  static int readBlocks(unsigned char *blocks[], int blockNums[], int count);
+  static int writeBlocks(unsigned char *blocks[], int blockNums[], int count);
+  static int readBlockAsync(unsigned char *block, int blockNum, int *request);
+  static int writeBlockAsync(unsigned char *block, int blockNum);
+  static int wait(int request);
+  static bool isAsync();
+  static int commit();
+  static unsigned char *getBlockPtr(int blockNum);
+  static struct DiskStats getStats();
+  static void resetStats();
+
+  static int readFully(int fd, void *buf, size_t size, off_t offset);
+  static int writeFully(int fd, const void *buf, size_t size, off_t offset);
+  static int readvFully(int fd, struct iovec *iov, int iovcnt, off_t offset);
+  static int writevFully(int fd, struct iovec *iov, int iovcnt, off_t offset);
 };
-#endif  // NITCBASE_H
\ No newline at end of file
+#endif  // NITCBASE_H
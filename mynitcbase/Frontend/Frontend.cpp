@@ -187,3 +187,27 @@ int Frontend::custom_function(int argc, char argv[][ATTR_SIZE]) {
 
   return SUCCESS;
 }
+
+int Frontend::commit() {
+  // write the modified catalog entries in the caches back to their blocks,
+  // then commit all the modified blocks at once
+  int ret = OpenRelTable::writeBack();
+  if (ret != SUCCESS) {
+    return ret;
+  }
+  return StaticBuffer::commit();
+}
+
+int Frontend::get_stats(struct BufferStats *buffer_stats, struct DiskStats *disk_stats,
+                        char relnames[][ATTR_SIZE], int *relation_count) {
+  // the counters of the buffer and of the disk since the last reset
+  *relation_count = StaticBuffer::getStats(buffer_stats, relnames);
+  *disk_stats = Disk::getStats();
+  return SUCCESS;
+}
+
+int Frontend::reset_stats() {
+  StaticBuffer::resetStats();
+  Disk::resetStats();
+  return SUCCESS;
+}
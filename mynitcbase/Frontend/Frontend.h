@@ -49,6 +49,15 @@ class Frontend {
                                              int attr_count, char attr_list[][ATTR_SIZE]);
 
   static int custom_function(int argc, char argv[][ATTR_SIZE]);
+
+  // Durability
+  static int commit();
+
+  // Statistics
+  static int get_stats(struct BufferStats *buffer_stats, struct DiskStats *disk_stats,
+                       char relnames[][ATTR_SIZE], int *relation_count);
+
+  static int reset_stats();
 };
 
 #endif  // FRONTEND_INTERFACE_FRONTEND_H
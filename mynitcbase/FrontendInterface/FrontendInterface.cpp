@@ -23,6 +23,14 @@ void printErrorMsg(int error);
 
 void printHelp();
 
+void commitCommand();
+
+void printStatsRow(const char *name, struct BufferCounters *counters);
+
+void dumpStatsCounters(fstream &file, struct BufferCounters *counters);
+
+const char *blockTypeNames[BMAP + 1] = {"REC", "IND_INTERNAL", "IND_LEAF", "UNUSED_BLK", "BMAP"};
+
 // extract tokens delimited by whitespace and comma
 vector<string> RegexHandler::extractTokens(string input) {
   regex re("\\s*,\\s*|\\s+");
@@ -464,6 +472,86 @@ int RegexHandler::customFunctionHandler() {
   return ret;
 }
 
+int RegexHandler::statsHandler() {
+  struct BufferStats bufferStats;
+  struct DiskStats diskStats;
+  char relNames[MAX_STATS_RELATIONS][ATTR_SIZE];
+  int relCount;
+
+  int ret = Frontend::get_stats(&bufferStats, &diskStats, relNames, &relCount);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  printf("%-16s %10s %10s %10s %10s %10s %10s %10s %7s\n", "Buffer", "hits", "misses",
+         "readahead", "evictions", "writebacks", "flushed", "committed", "hit %");
+  printStatsRow("total", &bufferStats.total);
+  printf("by block type:\n");
+  for (int type = 0; type <= BMAP; type++) {
+    printStatsRow(blockTypeNames[type], &bufferStats.byType[type]);
+  }
+  printf("by relation:\n");
+  for (int i = 0; i < relCount; i++) {
+    printStatsRow(relNames[i], &bufferStats.byRelation[i]);
+  }
+  printf("Disk: %lu reads (%lu blocks), %lu writes (%lu blocks), %lu commits\n",
+         diskStats.reads, diskStats.blocksRead, diskStats.writes, diskStats.blocksWritten,
+         diskStats.commits);
+  return SUCCESS;
+}
+
+int RegexHandler::statsResetHandler() {
+  int ret = Frontend::reset_stats();
+  if (ret == SUCCESS) {
+    cout << "Statistics reset successfully" << endl;
+  }
+  return ret;
+}
+
+// writes the statistics as JSON, for scripts comparing runs
+int RegexHandler::statsDumpHandler() {
+  struct BufferStats bufferStats;
+  struct DiskStats diskStats;
+  char relNames[MAX_STATS_RELATIONS][ATTR_SIZE];
+  int relCount;
+
+  int ret = Frontend::get_stats(&bufferStats, &diskStats, relNames, &relCount);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  string fileName = m[1];
+  fstream file;
+  file.open(OUTPUT_FILES_PATH + fileName, ios::out | ios::trunc);
+  if (!file.is_open()) {
+    cout << "The file " << fileName << " could not be created\n";
+    return FAILURE;
+  }
+
+  file << "{\n  \"buffer\": {\n    \"total\": ";
+  dumpStatsCounters(file, &bufferStats.total);
+  file << ",\n    \"byType\": {";
+  for (int type = 0; type <= BMAP; type++) {
+    file << (type == 0 ? "\n" : ",\n") << "      \"" << blockTypeNames[type] << "\": ";
+    dumpStatsCounters(file, &bufferStats.byType[type]);
+  }
+  file << "\n    },\n    \"byRelation\": {";
+  for (int i = 0; i < relCount; i++) {
+    file << (i == 0 ? "\n" : ",\n") << "      \"" << relNames[i] << "\": ";
+    dumpStatsCounters(file, &bufferStats.byRelation[i]);
+  }
+  file << (relCount == 0 ? "" : "\n    ") << "}\n  },\n";
+  file << "  \"disk\": {\"reads\": " << diskStats.reads
+       << ", \"blocksRead\": " << diskStats.blocksRead
+       << ", \"writes\": " << diskStats.writes
+       << ", \"blocksWritten\": " << diskStats.blocksWritten
+       << ", \"commits\": " << diskStats.commits << "}\n}\n";
+  file.close();
+
+  cout << "Statistics written to " << fileName << endl;
+  return SUCCESS;
+}
+
 int RegexHandler::handle(const string command) {
   for (auto iter = handlers.begin(); iter != handlers.end(); ++iter) {
     regex testCommand = iter->first;
@@ -482,6 +570,16 @@ int RegexHandler::handle(const string command) {
   return FAILURE;
 }
 
+// commit the changes of the commands executed so far. This is done once per
+// command typed at the prompt, so all the commands of a batch file (run from
+// the prompt or the command line) are committed together.
+void commitCommand() {
+  int ret = Frontend::commit();
+  if (ret != SUCCESS) {
+    printErrorMsg(ret);
+  }
+}
+
 RegexHandler FrontendInterface::regexHandler;
 int FrontendInterface::handleFrontend(int argc, char *argv[]) {
   // Taking Run Command as Command Line Argument(if provided)
@@ -492,6 +590,7 @@ int FrontendInterface::handleFrontend(int argc, char *argv[]) {
     if (ret == EXIT) {
       return 0;
     }
+    commitCommand();
   }
   char *buf;
   rl_bind_key('\t', rl_insert);
@@ -504,6 +603,7 @@ int FrontendInterface::handleFrontend(int argc, char *argv[]) {
     if (ret == EXIT) {
       return 0;
     }
+    commitCommand();
   }
   return 0;
 }
@@ -581,6 +681,32 @@ void printErrorMsg(int error) {
     cout << "Error: This operation is not permitted" << endl;
   else if (error == E_INDEX_BLOCKS_RELEASED)
     cout << "Warning: Operation succeeded, but some indexes had to be dropped" << endl;
+  else if (error == E_DISKIO)
+    cout << "Error: Disk read/write failed" << endl;
+  else if (error == E_BUFFERFULL)
+    cout << "Error: Every buffer holds a pinned block" << endl;
+}
+
+void printStatsRow(const char *name, struct BufferCounters *counters) {
+  unsigned long accesses = counters->hits + counters->misses;
+  printf("%-16s %10lu %10lu %10lu %10lu %10lu %10lu %10lu", name, counters->hits,
+         counters->misses, counters->readAheads, counters->evictions, counters->writeBacks,
+         counters->flushed, counters->committed);
+  if (accesses > 0) {
+    printf(" %6.1f%%\n", 100.0 * counters->hits / accesses);
+  } else {
+    printf(" %7s\n", "-");
+  }
+}
+
+void dumpStatsCounters(fstream &file, struct BufferCounters *counters) {
+  file << "{\"hits\": " << counters->hits
+       << ", \"misses\": " << counters->misses
+       << ", \"readAheads\": " << counters->readAheads
+       << ", \"evictions\": " << counters->evictions
+       << ", \"writeBacks\": " << counters->writeBacks
+       << ", \"flushed\": " << counters->flushed
+       << ", \"committed\": " << counters->committed << "}";
 }
 
 void printHelp() {
@@ -602,5 +728,8 @@ void printHelp() {
   printf("SELECT Attribute1,Attribute2,.. FROM source_relation1 JOIN source_relation2 INTO target_relation WHERE source_relation1.attribute1 = source_relation2.attribute2; \n\t-creates a new relation by equi-join of both the source relations with the attributes specified \n\n");
   printf("echo <any message> \n\t  -echo back the given string. \n\n");
   printf("run <filename> \n\t  -run commands from an input file in sequence. \n\n");
+  printf("stats \n\t  -show the use of the buffer (hits, misses, evictions, write-backs) in total, by block type and by relation, and the disk I/O. \n\n");
+  printf("stats reset \n\t  -reset the statistics. \n\n");
+  printf("stats dump <filename> \n\t  -write the statistics as JSON to a file in Files/Output_Files. \n\n");
   printf("exit \n\t-Exit the interface\n");
 }
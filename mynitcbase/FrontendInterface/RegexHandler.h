@@ -32,6 +32,11 @@
 #define INSERT_MULTIPLE_CMD "\\s*INSERT\\s+INTO\\s+([A-Za-z0-9_-]+)\\s+VALUES\\s+FROM\\s+([a-zA-Z0-9_-]+\\.csv)\\s*;?"
 #define CUSTOM_CMD "\\s*FUNCTION\\s+([A-Za-z,#0-9\\s()_-]+)\\s*;?"
 
+/* Statistics Commands */
+#define STATS_CMD "\\s*STATS\\s*;?"
+#define STATS_RESET_CMD "\\s*STATS\\s+RESET\\s*;?"
+#define STATS_DUMP_CMD "\\s*STATS\\s+DUMP\\s+([a-zA-Z0-9_-]+(?:\\.[a-zA-Z0-9_-]+)*)\\s*;?"
+
 #define REGEX(c) std::regex(c, std::regex_constants::icase)
 
 class RegexHandler {
@@ -61,6 +66,9 @@ class RegexHandler {
       {REGEX(SELECT_FROM_JOIN_CMD), &RegexHandler::selectFromJoinHandler},
       {REGEX(SELECT_ATTR_FROM_JOIN_CMD), &RegexHandler::selectAttrFromJoinHandler},
       {REGEX(CUSTOM_CMD), &RegexHandler::customFunctionHandler},
+      {REGEX(STATS_CMD), &RegexHandler::statsHandler},
+      {REGEX(STATS_RESET_CMD), &RegexHandler::statsResetHandler},
+      {REGEX(STATS_DUMP_CMD), &RegexHandler::statsDumpHandler},
   };
 
   // extract tokens delimited by whitespace and comma
@@ -89,6 +97,9 @@ class RegexHandler {
   int selectFromJoinHandler();
   int selectAttrFromJoinHandler();
   int customFunctionHandler();
+  int statsHandler();
+  int statsResetHandler();
+  int statsDumpHandler();
 
  public:
   int handle(const std::string command);
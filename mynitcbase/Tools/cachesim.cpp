@@ -0,0 +1,208 @@
+/*
+ * cachesim: replays a trace of the accesses to the buffer (recorded with
+ * --trace, see AccessTrace) against each replacement policy of the buffer, for
+ * a range of buffer capacities, and prints the miss ratio of each (the miss
+ * ratio curves), so that --buffers and --replacement can be chosen for a
+ * workload without running it again.
+ *
+ *   ./cachesim <trace file> [capacity ...]
+ *
+ * The capacities default to MIN_BUFFER_CAPACITY, doubled until the buffer
+ * holds every block of the trace, and the capacity the trace was recorded
+ * with. The buffer is split into shards as in StaticBuffer, each with its own
+ * policy. Read-ahead is not simulated: blocks read ahead in the session are
+ * misses here (and hits in the ratio recorded).
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../Buffer/AccessTrace.h"
+#include "../Buffer/ReplacementPolicy.h"
+#include "../Config/Config.h"
+#include "../define/constants.h"
+
+const char *policyNames[] = {"lru", "clock", "2q"};
+const int policies[] = {REPLACEMENT_LRU, REPLACEMENT_CLOCK, REPLACEMENT_2Q};
+const int numPolicies = 3;
+const char *blockTypeNames[BMAP + 1] = {"REC", "IND_INTERNAL", "IND_LEAF", "UNUSED_BLK", "BMAP"};
+
+/* read the header and the records of a trace file into *header and records */
+static bool readTrace(const char *path, struct TraceHeader *header, std::vector<uint32_t> &records) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    printf("Could not open the trace file %s\n", path);
+    return false;
+  }
+
+  if (fread(header, sizeof(*header), 1, file) != 1 ||
+      memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0) {
+    printf("%s is not a trace file\n", path);
+    fclose(file);
+    return false;
+  }
+
+  uint32_t batch[TRACE_BATCH];
+  size_t numRead;
+  while ((numRead = fread(batch, sizeof(uint32_t), TRACE_BATCH, file)) > 0) {
+    records.insert(records.end(), batch, batch + numRead);
+  }
+  fclose(file);
+  return true;
+}
+
+/*
+Returns the number of misses of a buffer of `capacity` blocks replacing them
+with `policy` over the accesses of the trace (the buffer starts empty, as in a
+session).
+*/
+static long simulate(std::vector<uint32_t> &records, int policy, int capacity) {
+  // the shards, as set up by StaticBuffer
+  int numShards = 1;
+  while (numShards * 2 <= MAX_BUFFER_SHARDS && capacity / (numShards * 2) >= MIN_SHARD_CAPACITY) {
+    numShards *= 2;
+  }
+  std::vector<ReplacementPolicy *> shardPolicies(numShards);
+  std::vector<std::vector<int>> freeBuffers(numShards);
+  int firstBuffer = 0;
+  for (int shardIndex = 0; shardIndex < numShards; shardIndex++) {
+    int shardCapacity = capacity / numShards + (shardIndex < capacity % numShards ? 1 : 0);
+    shardPolicies[shardIndex] = ReplacementPolicy::create(policy, firstBuffer, shardCapacity);
+    for (int i = shardCapacity - 1; i >= 0; i--) {
+      freeBuffers[shardIndex].push_back(firstBuffer + i);
+    }
+    firstBuffer += shardCapacity;
+  }
+
+  std::vector<int> bufferOf(DISK_BLOCKS, -1);
+  std::vector<int> blockOf(capacity, -1);
+  long misses = 0;
+
+  for (uint32_t record : records) {
+    int blockNum = TRACE_BLOCK_NUM(record);
+    if (blockNum < 0 || blockNum >= DISK_BLOCKS) {
+      continue;
+    }
+    int shardIndex = (blockNum / SHARD_BLOCK_RUN) & (numShards - 1);
+    ReplacementPolicy *shardPolicy = shardPolicies[shardIndex];
+
+    if (bufferOf[blockNum] != -1) {
+      shardPolicy->access(bufferOf[blockNum]);
+      continue;
+    }
+
+    misses++;
+    int bufferNum;
+    if (!freeBuffers[shardIndex].empty()) {
+      bufferNum = freeBuffers[shardIndex].back();
+      freeBuffers[shardIndex].pop_back();
+    } else {
+      bufferNum = shardPolicy->getVictim(nullptr);
+      shardPolicy->remove(bufferNum, blockOf[bufferNum]);
+      bufferOf[blockOf[bufferNum]] = -1;
+    }
+    shardPolicy->insert(bufferNum, blockNum);
+    bufferOf[blockNum] = bufferNum;
+    blockOf[bufferNum] = blockNum;
+  }
+
+  for (int shardIndex = 0; shardIndex < numShards; shardIndex++) {
+    delete shardPolicies[shardIndex];
+  }
+  return misses;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    printf("Usage: %s <trace file> [capacity ...]\n", argv[0]);
+    return 1;
+  }
+
+  struct TraceHeader header;
+  std::vector<uint32_t> records;
+  if (!readTrace(argv[1], &header, records)) {
+    return 1;
+  }
+  if (records.empty()) {
+    printf("The trace has no accesses\n");
+    return 0;
+  }
+
+  // summary of the trace
+  long hits = 0;
+  long byType[BMAP + 1] = {0};
+  std::vector<bool> seen(DISK_BLOCKS, false);
+  int numBlocks = 0;
+  for (uint32_t record : records) {
+    int blockNum = TRACE_BLOCK_NUM(record);
+    int blockType = TRACE_BLOCK_TYPE(record);
+    hits += TRACE_HIT(record) ? 1 : 0;
+    if (blockType <= BMAP) {
+      byType[blockType]++;
+    }
+    if (blockNum < DISK_BLOCKS && !seen[blockNum]) {
+      seen[blockNum] = true;
+      numBlocks++;
+    }
+  }
+
+  int recordedPolicy = header.replacementPolicy;
+  printf("Trace %s: recorded with %d buffers, %s replacement, read-ahead %d\n", argv[1],
+         header.bufferCapacity,
+         recordedPolicy >= 0 && recordedPolicy < numPolicies ? policyNames[recordedPolicy] : "?",
+         header.readAheadBlocks);
+  printf("%zu accesses to %d blocks, %.2f%% missed in the session\n", records.size(), numBlocks,
+         100.0 * (records.size() - hits) / records.size());
+  for (int type = 0; type <= BMAP; type++) {
+    if (byType[type] > 0) {
+      printf("  %-12s %10ld accesses\n", blockTypeNames[type], byType[type]);
+    }
+  }
+
+  // the capacities to simulate
+  std::vector<int> capacities;
+  for (int i = 2; i < argc; i++) {
+    int capacity = atoi(argv[i]);
+    if (capacity < MIN_BUFFER_CAPACITY || capacity > DISK_BLOCKS) {
+      printf("Invalid capacity %s (%d to %d buffers)\n", argv[i], MIN_BUFFER_CAPACITY, DISK_BLOCKS);
+      return 1;
+    }
+    capacities.push_back(capacity);
+  }
+  if (capacities.empty()) {
+    int capacity = MIN_BUFFER_CAPACITY;
+    while (true) {
+      capacities.push_back(capacity);
+      if (capacity >= numBlocks || capacity == DISK_BLOCKS) {
+        break;
+      }
+      capacity = std::min(capacity * 2, DISK_BLOCKS);
+    }
+    if (header.bufferCapacity >= MIN_BUFFER_CAPACITY && header.bufferCapacity <= DISK_BLOCKS) {
+      capacities.push_back(header.bufferCapacity);
+    }
+  }
+  std::sort(capacities.begin(), capacities.end());
+  capacities.erase(std::unique(capacities.begin(), capacities.end()), capacities.end());
+
+  // the miss ratio curves
+  printf("\nMiss ratio (%%) by number of buffers\n%8s", "buffers");
+  for (int p = 0; p < numPolicies; p++) {
+    printf(" %8s", policyNames[p]);
+  }
+  printf("\n");
+  for (int capacity : capacities) {
+    // 2Q keeps its a1in queue larger than the read-ahead window of the session
+    Config::readAheadBlocks = std::min((int)header.readAheadBlocks, capacity / 2);
+    printf("%8d", capacity);
+    for (int p = 0; p < numPolicies; p++) {
+      long misses = simulate(records, policies[p], capacity);
+      printf(" %8.2f", 100.0 * misses / records.size());
+    }
+    printf("%s\n", capacity == header.bufferCapacity ? "  (recorded)" : "");
+  }
+
+  return 0;
+}
@@ -0,0 +1,430 @@
+#include "WAL.h"
+
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "../Disk_Class/Disk.h"
+
+/*
+ * The log is a sequence of records of the following layout:
+ *
+ *   | header | block | header | block | header (commit) | header | block | ...
+ *
+ * where each header is a LogRecordHeader and the block following it is
+ * BLOCK_SIZE bytes. A commit header has blockNum = LOG_COMMIT and no block
+ * after it. The blocks before the last commit record are committed; the ones
+ * after it belong to statements that had not been committed yet and are
+ * discarded on recovery.
+ */
+struct LogRecordHeader {
+  int32_t magic;
+  int32_t blockNum;
+};
+
+#define LOG_MAGIC 0x4c41574e  // marks a valid log record
+#define LOG_COMMIT -2         // blockNum of a commit record
+#define LOG_RECORD_SIZE ((off_t)sizeof(LogRecordHeader) + BLOCK_SIZE)
+
+// staging area for a run of blocks copied from the log to the disk
+static unsigned char runBuffer[MAX_IO_BLOCKS][BLOCK_SIZE];
+
+int WAL::diskFd = -1;
+int WAL::logFd = -1;
+off_t WAL::logEnd = 0;
+off_t WAL::commitEnd = 0;
+off_t WAL::logOffset[DISK_BLOCKS];
+int WAL::pendingWrite[DISK_BLOCKS];
+bool WAL::logDamaged = false;
+
+/*
+ * Used to start logging the writes made to the disk (given by its descriptor).
+ * A log left behind by the previous session is recovered first.
+ */
+int WAL::open(int diskFd) {
+  WAL::diskFd = diskFd;
+  logFd = -1;
+  logEnd = 0;
+  commitEnd = 0;
+  logDamaged = false;
+  for (int i = 0; i < DISK_BLOCKS; i++) {
+    logOffset[i] = -1;
+    pendingWrite[i] = ASYNC_NO_REQUEST;
+  }
+
+  int ret = recover();
+  if (ret != SUCCESS) {
+    // the disk is not consistent without the old log, so it must not be used
+    // (or the old log overwritten) by this session
+    for (int i = 0; i < DISK_BLOCKS; i++) {
+      logOffset[i] = -1;
+    }
+    WAL::diskFd = -1;
+  }
+  return ret;
+}
+
+/*
+ * Used on graceful termination: everything logged is committed and
+ * checkpointed into the disk, and the log is removed.
+ */
+int WAL::close() {
+  int ret = commit();
+  if (ret == SUCCESS) {
+    ret = checkpoint();
+  }
+
+  if (logFd != -1) {
+    ::close(logFd);
+    logFd = -1;
+  }
+
+  // on failure the log stays behind and is recovered by the next session
+  if (ret == SUCCESS) {
+    unlink(DISK_WAL_PATH);
+  }
+  return ret;
+}
+
+/*
+ * Used to redo the committed blocks of a log left behind by the previous
+ * session (which was either killed or could not checkpoint its log).
+ * The latest committed image of each block is written to the disk; blocks
+ * logged after the last commit record are discarded.
+ */
+int WAL::recover() {
+  int fd = ::open(DISK_WAL_PATH, O_RDWR);
+  if (fd == -1) {
+    // nothing to recover
+    return SUCCESS;
+  }
+
+  // find the latest image of each block up to the last commit record. The
+  // scan stops at the first incomplete or invalid record.
+  off_t pending[DISK_BLOCKS];
+  for (int i = 0; i < DISK_BLOCKS; i++) {
+    pending[i] = -1;
+  }
+  bool committed = false;
+
+  off_t offset = 0;
+  LogRecordHeader header;
+  while (Disk::readFully(fd, &header, sizeof(header), offset) == SUCCESS &&
+         header.magic == LOG_MAGIC) {
+    offset += sizeof(header);
+
+    if (header.blockNum == LOG_COMMIT) {
+      // everything logged before this record is committed
+      for (int i = 0; i < DISK_BLOCKS; i++) {
+        if (pending[i] != -1) {
+          logOffset[i] = pending[i];
+          pending[i] = -1;
+        }
+      }
+      committed = true;
+      continue;
+    }
+
+    if (header.blockNum < 0 || header.blockNum >= DISK_BLOCKS) {
+      break;
+    }
+    pending[header.blockNum] = offset;
+    offset += BLOCK_SIZE;
+  }
+
+  int ret = SUCCESS;
+  if (committed) {
+    logFd = fd;
+    ret = checkpoint();
+    logFd = -1;
+  }
+  ::close(fd);
+
+  // keep the log if it could not be applied, so that the recovery is retried
+  // by the next session
+  if (ret == SUCCESS) {
+    unlink(DISK_WAL_PATH);
+  }
+  return ret;
+}
+
+/*
+ * Used to write the latest image of every logged block to the disk, in block
+ * number order so that the disk is written sequentially (each run of
+ * consecutive blocks with a single write). Everything logged must
+ * have been committed. Once the disk is synced the log is emptied.
+ */
+int WAL::checkpoint() {
+  if (logFd == -1) {
+    return SUCCESS;
+  }
+  if (diskFd == -1) {
+    return E_DISKIO;
+  }
+
+  int ret = SUCCESS;
+  int blockNum = 0;
+  while (blockNum < DISK_BLOCKS && ret == SUCCESS) {
+    if (logOffset[blockNum] == -1) {
+      blockNum++;
+      continue;
+    }
+
+    // gather the images of the run of consecutive logged blocks starting at
+    // blockNum. Images that are adjacent records in the log (as written by
+    // writeBlocks()) are read together, skipping the headers between them.
+    LogRecordHeader headers[MAX_IO_BLOCKS];
+    struct iovec iov[2 * MAX_IO_BLOCKS];
+    int iovcnt = 0;
+    off_t readOffset = 0;
+
+    int runLength = 0;
+    while (blockNum + runLength < DISK_BLOCKS && runLength < MAX_IO_BLOCKS &&
+           logOffset[blockNum + runLength] != -1 && ret == SUCCESS) {
+      off_t offset = logOffset[blockNum + runLength];
+      if (iovcnt > 0 && offset == logOffset[blockNum + runLength - 1] + LOG_RECORD_SIZE) {
+        iov[iovcnt].iov_base = &headers[runLength];
+        iov[iovcnt].iov_len = sizeof(LogRecordHeader);
+        iovcnt++;
+      } else {
+        if (iovcnt > 0) {
+          ret = Disk::readvFully(logFd, iov, iovcnt, readOffset);
+        }
+        iovcnt = 0;
+        readOffset = offset;
+      }
+      iov[iovcnt].iov_base = runBuffer[runLength];
+      iov[iovcnt].iov_len = BLOCK_SIZE;
+      iovcnt++;
+      runLength++;
+    }
+    if (ret == SUCCESS) {
+      ret = Disk::readvFully(logFd, iov, iovcnt, readOffset);
+    }
+
+    if (ret == SUCCESS) {
+      ret = Disk::writeFully(diskFd, runBuffer, (size_t)runLength * BLOCK_SIZE,
+                             (off_t)blockNum * BLOCK_SIZE);
+    }
+    blockNum += runLength;
+  }
+  if (ret == SUCCESS && fsync(diskFd) != 0) {
+    ret = E_DISKIO;
+  }
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  for (int i = 0; i < DISK_BLOCKS; i++) {
+    logOffset[i] = -1;
+  }
+  logEnd = 0;
+  commitEnd = 0;
+
+  // the log of the running session is reused from its beginning
+  return (ftruncate(logFd, 0) == 0) ? SUCCESS : E_DISKIO;
+}
+
+/*
+ * Used to read the latest logged image of a block.
+ * Returns E_BLOCKNOTINBUFFER if the block is not in the log, in which case it
+ * must be read from the disk.
+ */
+int WAL::readBlock(unsigned char *block, int blockNum) {
+  if (logOffset[blockNum] == -1) {
+    return E_BLOCKNOTINBUFFER;
+  }
+
+  int ret = waitPendingWrite(blockNum);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+  return Disk::readFully(logFd, block, BLOCK_SIZE, logOffset[blockNum]);
+}
+
+/*
+ * Used to check if a block has been logged since the last checkpoint (in which
+ * case the disk does not hold its latest image).
+ */
+bool WAL::isLogged(int blockNum) {
+  return logOffset[blockNum] != -1;
+}
+
+/*
+ * Used to log a new image of a block.
+ */
+int WAL::writeBlock(unsigned char *block, int blockNum) {
+  return writeBlocks(&block, &blockNum, 1);
+}
+
+/*
+ * Used to log new images of a set of blocks (blocks[i] is the image of block
+ * blockNums[i]).
+ * If the latest image of a block is not committed yet it is overwritten in
+ * place; the other blocks are appended to the log as new records, upto
+ * MAX_IO_BLOCKS records with a single pwritev.
+ */
+int WAL::writeBlocks(unsigned char *blocks[], int blockNums[], int count) {
+  int ret = openLog();
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  LogRecordHeader headers[MAX_IO_BLOCKS];
+  struct iovec iov[2 * MAX_IO_BLOCKS];
+  int numRecords = 0;
+
+  for (int i = 0; i < count; i++) {
+    int blockNum = blockNums[i];
+
+    // an earlier write of the block still in flight could land after this one
+    ret = waitPendingWrite(blockNum);
+    if (ret != SUCCESS) {
+      return ret;
+    }
+
+    if (logOffset[blockNum] >= commitEnd) {
+      ret = Disk::writeFully(logFd, blocks[i], BLOCK_SIZE, logOffset[blockNum]);
+      if (ret != SUCCESS) {
+        return ret;
+      }
+    } else {
+      headers[numRecords] = {LOG_MAGIC, blockNum};
+      iov[2 * numRecords].iov_base = &headers[numRecords];
+      iov[2 * numRecords].iov_len = sizeof(LogRecordHeader);
+      iov[2 * numRecords + 1].iov_base = blocks[i];
+      iov[2 * numRecords + 1].iov_len = BLOCK_SIZE;
+      numRecords++;
+    }
+
+    // append the gathered records when the batch is full or at the end
+    if (numRecords == MAX_IO_BLOCKS || (i == count - 1 && numRecords > 0)) {
+      ret = Disk::writevFully(logFd, iov, 2 * numRecords, logEnd);
+      if (ret != SUCCESS) {
+        return ret;
+      }
+      for (int k = 0; k < numRecords; k++) {
+        logOffset[headers[k].blockNum] = logEnd + k * LOG_RECORD_SIZE + sizeof(LogRecordHeader);
+      }
+      logEnd += numRecords * LOG_RECORD_SIZE;
+      numRecords = 0;
+    }
+  }
+
+  return SUCCESS;
+}
+
+/*
+ * Used to start logging a new image of a block without waiting for the write
+ * (see AsyncIO). The block may be reused as soon as this returns; the write is
+ * waited for before the block is read back from the log, written again, or
+ * committed.
+ */
+int WAL::writeBlockAsync(unsigned char *block, int blockNum) {
+  int ret = openLog();
+  if (ret == SUCCESS) {
+    ret = waitPendingWrite(blockNum);
+  }
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  if (logOffset[blockNum] >= commitEnd) {
+    struct iovec iov = {block, BLOCK_SIZE};
+    return AsyncIO::writev(logFd, &iov, 1, logOffset[blockNum], &pendingWrite[blockNum]);
+  }
+
+  LogRecordHeader header = {LOG_MAGIC, blockNum};
+  struct iovec iov[2] = {{&header, sizeof(header)}, {block, BLOCK_SIZE}};
+  ret = AsyncIO::writev(logFd, iov, 2, logEnd, &pendingWrite[blockNum]);
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  logOffset[blockNum] = logEnd + sizeof(header);
+  logEnd += LOG_RECORD_SIZE;
+  return SUCCESS;
+}
+
+/* create the log of the session if it has not been created yet */
+int WAL::openLog() {
+  if (diskFd == -1) {
+    return E_DISKIO;
+  }
+
+  if (logFd == -1) {
+    logFd = ::open(DISK_WAL_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (logFd == -1) {
+      return E_DISKIO;
+    }
+  }
+  return SUCCESS;
+}
+
+/*
+ * Used to wait for the asynchronous write of a block (if any).
+ * If it failed, the record is lost and the log cannot be committed any more.
+ */
+int WAL::waitPendingWrite(int blockNum) {
+  if (pendingWrite[blockNum] == ASYNC_NO_REQUEST) {
+    return SUCCESS;
+  }
+
+  int ret = AsyncIO::wait(pendingWrite[blockNum]);
+  pendingWrite[blockNum] = ASYNC_NO_REQUEST;
+  if (ret != SUCCESS) {
+    logDamaged = true;
+  }
+  return ret;
+}
+
+/* Used to wait for all the asynchronous writes to the log */
+int WAL::waitPendingWrites() {
+  int ret = SUCCESS;
+  for (int blockNum = 0; blockNum < DISK_BLOCKS; blockNum++) {
+    int waitRet = waitPendingWrite(blockNum);
+    if (waitRet != SUCCESS) {
+      ret = waitRet;
+    }
+  }
+  return ret;
+}
+
+/*
+ * Used to commit every block logged since the last commit.
+ * The asynchronous writes to the log are waited for, and the blocks are synced before the commit record is written, so that a commit
+ * record can never be durable without the blocks it covers. When the log grows
+ * beyond WAL_CHECKPOINT_BLOCKS blocks it is checkpointed into the disk.
+ */
+int WAL::commit() {
+  if (waitPendingWrites() != SUCCESS || logDamaged) {
+    return E_DISKIO;
+  }
+
+  if (logEnd == commitEnd) {
+    // nothing was logged since the last commit
+    return SUCCESS;
+  }
+
+  if (fdatasync(logFd) != 0) {
+    return E_DISKIO;
+  }
+
+  LogRecordHeader header = {LOG_MAGIC, LOG_COMMIT};
+  int ret = Disk::writeFully(logFd, &header, sizeof(header), logEnd);
+  if (ret == SUCCESS && fdatasync(logFd) != 0) {
+    ret = E_DISKIO;
+  }
+  if (ret != SUCCESS) {
+    return ret;
+  }
+
+  logEnd += sizeof(header);
+  commitEnd = logEnd;
+
+  if (logEnd > (off_t)WAL_CHECKPOINT_BLOCKS * BLOCK_SIZE) {
+    return checkpoint();
+  }
+  return SUCCESS;
+}
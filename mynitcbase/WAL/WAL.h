@@ -0,0 +1,53 @@
+#ifndef NITCBASE_WAL_H
+#define NITCBASE_WAL_H
+
+#include <sys/types.h>
+
+#include "../Disk_Class/AsyncIO.h"
+#include "../define/constants.h"
+
+/*
+ * Write-ahead redo log of the disk.
+ * Blocks written by the buffer are appended to the log instead of being
+ * written to their place on the disk. A commit makes every block logged so far
+ * durable with a single sync of the log (so all the statements since the last
+ * commit are committed as a group). The committed blocks reach the disk only
+ * when the log is checkpointed, in block number order.
+ */
+class WAL {
+ private:
+  // fields
+  static int diskFd;
+  // descriptor of the log (-1 until the first block is logged)
+  static int logFd;
+  // end of the log, and end of its last commit record
+  static off_t logEnd;
+  static off_t commitEnd;
+  // logOffset[blockNum] = offset of the latest image of the block in the log,
+  // or -1 if the block has not been logged since the last checkpoint
+  static off_t logOffset[DISK_BLOCKS];
+  // pendingWrite[blockNum] = asynchronous write of the block's latest image
+  // that has not been waited for (ASYNC_NO_REQUEST if none)
+  static int pendingWrite[DISK_BLOCKS];
+  // set if an asynchronous append failed, leaving a hole in the log
+  static bool logDamaged;
+
+  // methods
+  static int recover();
+  static int checkpoint();
+  static int openLog();
+  static int waitPendingWrite(int blockNum);
+  static int waitPendingWrites();
+
+ public:
+  static int open(int diskFd);
+  static int close();
+  static int readBlock(unsigned char *block, int blockNum);
+  static int writeBlock(unsigned char *block, int blockNum);
+  static int writeBlocks(unsigned char *blocks[], int blockNums[], int count);
+  static int writeBlockAsync(unsigned char *block, int blockNum);
+  static bool isLogged(int blockNum);
+  static int commit();
+};
+
+#endif  // NITCBASE_WAL_H
@@ -2,7 +2,7 @@
 #define NITCBASE_CONSTANTS_H
 
 #define DISK_PATH "../Disk/disk"                            // Path to disk
-#define DISK_RUN_COPY_PATH "../Disk/disk_run_copy"          // Path to run copy of the disk
+#define DISK_WAL_PATH "../Disk/disk_wal"                    // Path to the write-ahead log of the disk
 #define Files_Path "../Files/"                              // Path to Files directory
 #define INPUT_FILES_PATH "../Files/Input_Files/"            // Path to Input_Files directory inside the Files directory
 #define OUTPUT_FILES_PATH "../Files/Output_Files/"          // Path to Output_Files directory inside the Files directory
@@ -20,11 +20,28 @@
 #define INDEX_BLOCK_UNUSED_BYTES 8  // Size of unused field in index block (in bytes)
 #define INTERNAL_ENTRY_SIZE 24      // Size of an Internal Index Entry in the Internal Index Block (in bytes)
 #define LEAF_ENTRY_SIZE 32          // Size of an Leaf Index Entry in the Leaf Index Block (in bytes)
+#define MAX_SLOTS_PER_BLOCK 125     // Maximum number of slots in a Record Block (with a bitmap slot map and one attribute, see RecBuffer::getNumSlots())
 
 #define DISK_BLOCKS 8192             // Number of block in disk
-#define BUFFER_CAPACITY 32           // Total number of blocks available in the Buffer (Capacity of the Buffer in blocks)
+#define BUFFER_CAPACITY 32           // Default number of blocks available in the Buffer (Capacity of the Buffer in blocks, see --buffers)
+#define MIN_BUFFER_CAPACITY 4        // Smallest number of blocks the Buffer may be given (enough for the blocks pinned at a time)
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)  // Size of a huge page (for the memory of the Buffer, see --hugepages)
+#define MAX_BUFFER_SHARDS 8          // Maximum number of shards the Buffer is split into (each with its own lock)
+#define MIN_SHARD_CAPACITY 16        // Smallest number of blocks a shard of the Buffer is given
+#define SHARD_BLOCK_RUN 16           // Number of consecutive disk blocks mapped to the same shard of the Buffer
+#define MAX_READ_RETRIES 4           // Number of optimistic reads of a block tried before it is read under its latch
 #define MAX_OPEN 12                  // Maximum number of relations allowed to be open and cached in Cache Layer.
 #define BLOCK_ALLOCATION_MAP_SIZE 4  // Number of blocks given for Block Allocation Map in the disk
+#define READ_AHEAD_BLOCKS 8          // Default number of blocks read ahead when a scan walks a chain of blocks
+#define MAX_CHAIN_WALKS 4            // Number of chain walks (scans) tracked at a time for read-ahead
+#define EXTENT_BLOCKS 8              // Default number of consecutive blocks reserved at a time for the record blocks of a relation (see --extent)
+#define MAX_IO_BLOCKS 64             // Maximum number of blocks transferred by a single vectored disk I/O
+#define MAX_ASYNC_REQUESTS 64        // Maximum number of asynchronous disk I/O requests in flight
+#define MAX_FLUSH_BLOCKS 64         // Maximum number of dirty blocks queued for the background flusher (see --flusher)
+#define MAX_STATS_RELATIONS 32       // Number of relations the use of the Buffer is counted for (see STATS)
+#define STATS_BATCH 256              // Number of optimistic reads a thread counts by itself before adding them to the shared counters
+#define TRACE_BATCH 4096             // Number of buffer accesses gathered in memory before they are appended to the trace file (see --trace)
+#define WAL_CHECKPOINT_BLOCKS 4096   // Size of the write-ahead log (in blocks) beyond which a commit checkpoints it into the disk
 
 #define RELCAT_NO_ATTRS 6   // Number of attributes present in one entry / record of the Relation Catalog
 #define ATTRCAT_NO_ATTRS 6  // Number of attributes present in one entry / record of the Attribute Catalog
@@ -37,6 +54,7 @@
 
 #define SLOT_OCCUPIED '1'    // Value to mark a slot in Slotmap as Occupied
 #define SLOT_UNOCCUPIED '0'  // Value to mark a slot in Slotmap as Unoccupied
+#define SLOTMAP_BITMAP_TAG "SMB1"  // HeadInfo::reserved of a Record Block whose slotmap is a bitmap (a bit per slot, set if occupied; see RecBuffer)
 
 #define RELCAT_RELID 0   // Relid for Relation catalog
 #define ATTRCAT_RELID 1  // Relid for Attribute catalog
@@ -119,6 +137,8 @@ enum ReturnTypes {
   E_NOTFOUND,               // Search for requested record unsuccessful
   E_BLOCKNOTINBUFFER,       // Block not found in buffer
   E_INDEX_BLOCKS_RELEASED,  // Due to insufficient disk space, index blocks have been released from the disk
+  E_DISKIO,                 // Reading from or writing to the disk failed
+  E_BUFFERFULL,             // Every buffer holds a pinned block
 };
 
 #define TEMP ".temp"  // Used for internal purposes
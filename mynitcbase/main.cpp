@@ -1,7 +1,9 @@
+#include "Buffer/AccessTrace.h"
 #include "Buffer/StaticBuffer.h"
 #include "Cache/AttrCacheTable.h"
 #include "Cache/OpenRelTable.h"
 #include "Cache/RelCacheTable.h"
+#include "Config/Config.h"
 #include "Disk_Class/Disk.h"
 #include "FrontendInterface/FrontendInterface.h"
 #include "define/constants.h"
@@ -10,8 +12,15 @@
 
 int main(int argc, char *argv[]) {
 
-  // creating run copy of the disk
+  // read the session options (eg. the disk backend) before touching the disk
+  if (Config::parseArgs(&argc, argv) != SUCCESS) {
+    return 1;
+  }
+
+  // opening the disk (recovering committed changes from the write-ahead log)
   Disk disk_run;
+  // recording the accesses to the buffer (if asked to with --trace)
+  AccessTrace trace;
   StaticBuffer buffer;
   OpenRelTable cache;
 